@@ -1,9 +1,28 @@
 #include <iostream>
 #include <unordered_map>
+#include <unordered_set>
+#include <string_view>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
 #include <vector>
 #include <fstream>
+#include <sstream>
 #include <stack>
 #include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+#ifdef __AVX2__
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 
@@ -12,16 +31,291 @@ struct ruleOperation {
     bool NEW_LINE = false;
     string ENTER_STATE;
     int GO_BACK = 0;
+    int unitId = -1;    //index into unitNames, -1 if no unit is added
+    int enterState = -1;    //index into lexStates, -1 if the state doesn't change
 };
 
-unordered_map<string, vector<pair<unordered_map<int, unordered_map<char, vector<int>>>, ruleOperation>>> automatas;
-// automatas<lexStateName, listOf<pair<transitions<state, transition<input, listOf<newStates>>>, ruleOperation>>>
-string allInput;
+struct token {
+    int unitId;
+    int line;       //line as counted by NOVI_REDAK
+    size_t offset;  //position of the first character in the input
+    size_t length;
+    int lexState;   //lex state the token was recognized in
+    size_t readBefore;  //one past the furthest position read before the token was recognized (past the end of the input if the end was read)
+};
+
+/*
+Binary token stream (--binary file), all numbers little-endian so the file can be mmapped and read in place
+    tokenStreamHeader
+    tokenRecord[tokenCount]
+    symbolRecord[symbolCount]
+    unit names (namesLength bytes, every name followed by '\n', unitId is the index of the name)
+    token texts (textLength bytes, every symbol once)
+Every distinct token text is interned as a symbol, numbered densely in the order of first appearance,
+so equal identifiers have equal symbol IDs and later stages can compare them as integers
+*/
+struct tokenStreamHeader {
+    char magic[4] = {'P', 'P', 'J', 'T'};
+    uint32_t version = 2;
+    uint32_t unitCount = 0;
+    uint32_t tokenCount = 0;
+    uint32_t namesLength = 0;
+    uint32_t symbolCount = 0;
+    uint64_t textLength = 0;
+};
+
+struct tokenRecord {
+    uint16_t unitId;
+    uint16_t reserved;
+    uint32_t line;
+    uint32_t symbol;    //index into the symbol records
+};
+
+struct symbolRecord {
+    uint32_t offset;    //position of the text in the token texts
+    uint32_t length;
+};
+
+struct characterSet {
+    bool contains[256] = {};
+    unsigned char rows[2][16] = {};    //rows[high nibble / 8][low nibble] has bit (high nibble % 8) set for every contained character
+
+    void insert(unsigned char c) {
+        contains[c] = true;
+        rows[c >> 7][c & 0x0F] |= 1 << ((c >> 4) & 7);
+    }
+};
+
+//Characters from low to high except for the terminators are consumed by the state without doing anything
+struct skipLoop {
+    int low = 0;
+    int high = -1;  //empty range if the state doesn't have a skip loop
+    vector<unsigned char> terminators;
+};
+
+//Literal rules that were removed from the automatas, recognized through a perfect hash after their host rule matches
+struct keyword {
+    string literal;
+    int host = -1;  //index of the rule that recognizes the literal, -1 for an empty slot
+    ruleOperation ro;
+};
+struct keywordTable {
+    uint32_t size = 0;  //power of two
+    uint32_t seed = 0;
+    vector<keyword> slots;
+};
+
+struct lexState {
+    string name;
+    vector<pair<unordered_map<int, unordered_map<char, vector<int>>>, ruleOperation>> automatas;
+    // automatas<listOf<pair<transitions<state, transition<input, listOf<newStates>>>, ruleOperation>>>
+    characterSet startingCharacters;
+    skipLoop loop;
+    keywordTable keywords;
+    int dfaStart = 0;   //starting state of the lex state's DFA
+};
+
+vector<lexState> lexStates;
+unordered_map<string, int> lexStateIds;
+vector<int> dfaTransitions; //dfaTransitions[state * 256 + character] is the next DFA state, state 0 is the dead state
+vector<int> dfaAccepts;     //index of the rule recognized in a DFA state (the first one if there are several), -1 if none
+bool useENFA = false;       //simulate every ENFA separately instead of using the DFA
+string binaryOutput;        //write a binary token stream to this file instead of the text output
+bool batch = false;         //analyze the files given as arguments instead of the standard input
+bool batchBinary = false;   //write binary token streams in batch mode
+unsigned threadCount = 0;   //0 for one thread per core
+int laneCount = 1;          //sources every batch thread walks the DFA over at once (up to MAX_LANES)
+vector<string> batchPaths;
+struct sourceEdit {
+    size_t offset;
+    size_t removedLength;
+    string inserted;
+};
+vector<sourceEdit> edits;   //applied one after another with relex before the output
+string statsOutput;         //write the per rule counters as JSON to this file
+
+//Counters of a single rule in a single lex state
+//With the ENFAs every rule is simulated (and timed) on its own, with the DFA every scan simulates all rules at once and its time goes to the rule that won
+struct ruleStats {
+    uint64_t started = 0;   //simulations of the rule
+    uint64_t won = 0;       //tokens (or skipped parts of the input) recognized by the rule, keywords count for their host rule
+    uint64_t bytes = 0;     //characters consumed by the rule
+    uint64_t nanoseconds = 0;
+};
+struct lexStateStats {
+    vector<ruleStats> rules;
+    uint64_t failedScans = 0;   //scans in which no rule recognized anything
+    uint64_t failedNanoseconds = 0;     //time of the failed scans (only with the DFA)
+    uint64_t skippedBytes = 0;  //characters consumed by the skip loop instead of the rules
+};
+vector<string> unitNames;
+unordered_map<string, int> unitIds;
+int startingState;
+
+//Everything that belongs to the analysis of a single source, the tables above are only read while analyzing
+struct lexJob {
+    string path;                //empty for the standard input
+    string input;
+    vector<size_t> newlines;    //positions of all newlines in input, sorted
+    vector<token> tokens;
+    vector<pair<size_t, size_t>> errors;   //<start, end> of every run of unrecognized characters
+    size_t readEnd = 0;         //one past the furthest position read so far (past the end of the input if the end was read)
+    double milliseconds = 0;
+    vector<lexStateStats> stats;    //per lex state, only filled with --stats
+
+    //Reps' maximal munch memoization: (position * DFA state count + DFA state) pairs from which no rule can be recognized anymore
+    unordered_set<uint64_t> failedStates;
+    size_t scanFrontier = 0;    //positions at or after this one haven't been scanned yet
+    vector<pair<int, size_t>> scanPath;     //<DFA state, position> pairs visited since the last accepting state
+};
+
+//Find all newlines in s (16 characters at once with SSE2)
+void indexNewlines(const string &s, vector<size_t> &newlines) {
+    const char *data = s.data();
+    size_t end = s.length();
+    size_t pos = 0;
+#ifdef __SSE2__
+    const __m128i newline = _mm_set1_epi8('\n');
+    for ( ; pos + 16 <= end ; pos += 16) {
+        int found = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + pos)), newline));
+        while (found) {
+            newlines.push_back(pos + __builtin_ctz(found));
+            found &= found - 1;
+        }
+    }
+#endif
+    for ( ; pos < end ; pos++) {
+        if (data[pos] == '\n') newlines.push_back(pos);
+    }
+}
 
-void doTransition(unordered_map<int, unordered_map<char, vector<int>>> &automata, stack<int> &stateStack, vector<bool> &X, vector<bool> &Y, char input) {
+//returns the physical <line, column> (both starting from 1) of a position in the input
+pair<int, int> lineColumn(const vector<size_t> &newlines, size_t offset) {
+    size_t newlinesBefore = lower_bound(newlines.begin(), newlines.end(), offset) - newlines.begin();
+    if (newlinesBefore == 0) return make_pair(1, offset + 1);
+    return make_pair(newlinesBefore + 1, offset - newlines[newlinesBefore-1]);
+}
+
+//returns the position of the first character at or after pos that is in the set (or end if there is none)
+size_t findFirstInSet(const string &s, size_t pos, const characterSet &set) {
+    const char *data = s.data();
+    size_t end = s.length();
+#ifdef __SSSE3__
+    //Look up 16 characters at once: the low nibble selects a row and the high nibble selects a bit in it
+    const __m128i lowMask = _mm_set1_epi8(0x0F);
+    const __m128i bitTable = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    const __m128i rowsLow = _mm_loadu_si128((const __m128i*)set.rows[0]);
+    const __m128i rowsHigh = _mm_loadu_si128((const __m128i*)set.rows[1]);
+    for ( ; pos + 16 <= end ; pos += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(data + pos));
+        __m128i low = _mm_and_si128(chunk, lowMask);
+        __m128i high = _mm_and_si128(_mm_srli_epi16(chunk, 4), lowMask);
+        __m128i isHigh = _mm_cmpgt_epi8(high, _mm_set1_epi8(7));
+        __m128i row = _mm_or_si128(_mm_andnot_si128(isHigh, _mm_shuffle_epi8(rowsLow, low)), _mm_and_si128(isHigh, _mm_shuffle_epi8(rowsHigh, low)));
+        __m128i bit = _mm_shuffle_epi8(bitTable, high);
+        int found = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(row, bit), bit));
+        if (found) return pos + __builtin_ctz(found);
+    }
+#endif
+    while (pos < end && !set.contains[(unsigned char)data[pos]]) pos++;
+    return pos;
+}
+
+//returns the position of the first character at or after pos that the skip loop doesn't consume
+size_t skipCharacters(const string &s, size_t pos, const skipLoop &loop) {
+    const char *data = s.data();
+    size_t end = s.length();
+    const unsigned char *terminators = loop.terminators.data();
+    size_t terminatorCount = loop.terminators.size();
+
+    if (loop.low == 0 && loop.high == 255 && terminatorCount == 1) {
+        const void *found = memchr(data + pos, terminators[0], end - pos);
+        return found ? (const char*)found - data : end;
+    }
+#ifdef __AVX2__
+    //Characters are in range if max(c, low) == c and min(c, high) == c
+    const __m256i low32 = _mm256_set1_epi8(loop.low);
+    const __m256i high32 = _mm256_set1_epi8(loop.high);
+    for ( ; pos + 32 <= end ; pos += 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)(data + pos));
+        __m256i inRange = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(chunk, low32), chunk), _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, high32), chunk));
+        for (size_t i = 0 ; i < terminatorCount ; i++) inRange = _mm256_andnot_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(terminators[i])), inRange);
+        unsigned int stop = ~(unsigned int)_mm256_movemask_epi8(inRange);
+        if (stop) return pos + __builtin_ctz(stop);
+    }
+#endif
+#ifdef __SSE2__
+    const __m128i low16 = _mm_set1_epi8(loop.low);
+    const __m128i high16 = _mm_set1_epi8(loop.high);
+    for ( ; pos + 16 <= end ; pos += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(data + pos));
+        __m128i inRange = _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(chunk, low16), chunk), _mm_cmpeq_epi8(_mm_min_epu8(chunk, high16), chunk));
+        for (size_t i = 0 ; i < terminatorCount ; i++) inRange = _mm_andnot_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(terminators[i])), inRange);
+        int stop = ~_mm_movemask_epi8(inRange) & 0xFFFF;
+        if (stop) return pos + __builtin_ctz(stop);
+    }
+#endif
+    for ( ; pos < end ; pos++) {
+        unsigned char c = data[pos];
+        if (c < loop.low || c > loop.high || find(terminators, terminators + terminatorCount, c) != terminators + terminatorCount) break;
+    }
+    return pos;
+}
+
+//Seeded FNV-1a, the same function the generator used to place the keywords
+uint32_t keywordHash(const char *s, size_t length, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    for (size_t i = 0 ; i < length ; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+//returns the keyword that the text recognized by the host rule actually is (nullptr if it isn't a keyword)
+const keyword* findKeyword(const keywordTable &table, int host, const string &input, size_t startP, size_t length) {
+    if (table.size == 0) return nullptr;
+    const char *text = input.data() + startP;
+    const keyword &k = table.slots[keywordHash(text, length, table.seed) & (table.size - 1)];
+    if (k.host != host || k.literal.length() != length || k.literal.compare(0, length, text, length) != 0) return nullptr;
+    return &k;
+}
+
+//Report a run of characters that couldn't be recognized as a single error
+void reportError(lexJob &job, size_t startP, size_t endP) {
+    job.errors.push_back(make_pair(startP, endP));
+}
+
+//Write the error records, every one prefixed with prefix
+void writeErrors(const lexJob &job, ostream &output, const string &prefix) {
+    string records;
+    for (auto &error : job.errors) {
+        pair<int, int> position = lineColumn(job.newlines, error.first);
+        records += prefix + "Lexical error at " + to_string(position.first) + ':' + to_string(position.second) + ": " + job.input.substr(error.first, error.second - error.first) + '\n';
+    }
+    output << records;
+}
+
+//Remember that everything before end was read, end is past the end of the input if the end was reached
+void markRead(lexJob &job, size_t end) {
+    if (end >= job.input.length()) end = job.input.length() + 1;
+    job.readEnd = max(job.readEnd, end);
+}
+
+//returns the states the automata goes to from state after reading input (empty if there are none)
+const vector<int>& nextStates(const unordered_map<int, unordered_map<char, vector<int>>> &automata, int state, char input) {
+    static const vector<int> none;
+    auto transitions = automata.find(state);
+    if (transitions == automata.end()) return none;
+    auto transition = transitions->second.find(input);
+    if (transition == transitions->second.end()) return none;
+    return transition->second;
+}
+
+void doTransition(const unordered_map<int, unordered_map<char, vector<int>>> &automata, stack<int> &stateStack, vector<bool> &X, vector<bool> &Y, char input) {
     for (size_t i = 0 ; i < X.size() ; i++) {
         if (X[i]) {
-            for (int newState : automata[i][input]) {
+            for (int newState : nextStates(automata, i, input)) {
                 stateStack.push(newState);
                 Y[newState] = true;
             }
@@ -32,7 +326,7 @@ void doTransition(unordered_map<int, unordered_map<char, vector<int>>> &automata
     while (!stateStack.empty()) {
         int top = stateStack.top();
         stateStack.pop();
-        for (int newState : automata[top][-8]) {
+        for (int newState : nextStates(automata, top, -8)) {
             if (!(Y[newState])) {
                 stateStack.push(newState);
                 Y[newState] = true;
@@ -46,7 +340,8 @@ void doTransition(unordered_map<int, unordered_map<char, vector<int>>> &automata
 }
 
 //returns the number of characters that were recognized by the automata
-int simulateENFA(unordered_map<int, unordered_map<char, vector<int>>> &automata, int startP) {
+int simulateENFA(const unordered_map<int, unordered_map<char, vector<int>>> &automata, lexJob &job, size_t startP) {
+    const string &input = job.input;
     //Initialize a stack and 2 bit vectors
     stack<int> stateStack;
     vector<bool> X(automata.size(), false); //contains the current states
@@ -60,9 +355,9 @@ int simulateENFA(unordered_map<int, unordered_map<char, vector<int>>> &automata,
     int inputsRecognized = 0;
     size_t currentP = startP;
     
-    while(currentP < allInput.length()) {
+    while(currentP < input.length()) {
         if (any_of(X.begin(), X.end(), [](bool val) {return val;})) {   //if we are currently in at least one state
-            doTransition(automata, stateStack, X, Y, allInput[currentP]);
+            doTransition(automata, stateStack, X, Y, input[currentP]);
             currentP++;
             if (X[1]) inputsRecognized = currentP - startP; //if we are in the acceptable state (always and only state 1)
         }
@@ -70,16 +365,308 @@ int simulateENFA(unordered_map<int, unordered_map<char, vector<int>>> &automata,
             break;
         }
     }
+    markRead(job, currentP);
     
     return inputsRecognized;
 }
 
-int main() {
+//Build a DFA that simulates all ENFAs of the lex state at once
+void buildDFA(lexState &state) {
+    if (dfaAccepts.empty()) {   //dead state
+        dfaAccepts.push_back(-1);
+        dfaTransitions.resize(256, 0);
+    }
+
+    //Number the states of all ENFAs in a single range
+    vector<int> offsets;
+    int totalStates = 0;
+    for (auto &p : state.automatas) {
+        offsets.push_back(totalStates);
+        totalStates += p.first.size();
+    }
+    vector<vector<int>> epsilon(totalStates);
+    vector<vector<pair<unsigned char, int>>> moves(totalStates);
+    vector<int> accepting(totalStates, -1);    //rule whose accepting state this is
+    for (size_t rule = 0 ; rule < state.automatas.size() ; rule++) {
+        accepting[offsets[rule] + 1] = rule;
+        for (auto &s : state.automatas[rule].first) {
+            int from = offsets[rule] + s.first;
+            for (auto &transition : s.second) {
+                for (int to : transition.second) {
+                    if (transition.first == -8) epsilon[from].push_back(offsets[rule] + to);
+                    else moves[from].push_back(make_pair(transition.first, offsets[rule] + to));
+                }
+            }
+        }
+    }
+
+    //Subset construction, every DFA state is a sorted set of ENFA states
+    map<vector<int>, int> ids;
+    vector<vector<int>> pending;
+    vector<bool> inSet(totalStates, false);
+    auto addState = [&](vector<int> &set) {
+        for (int s : set) inSet[s] = true;
+        for (size_t i = 0 ; i < set.size() ; i++) {    //epsilon closure
+            for (int next : epsilon[set[i]]) {
+                if (!inSet[next]) {
+                    inSet[next] = true;
+                    set.push_back(next);
+                }
+            }
+        }
+        for (int s : set) inSet[s] = false;
+        if (set.empty()) return 0;
+        sort(set.begin(), set.end());
+        auto found = ids.find(set);
+        if (found != ids.end()) return found->second;
+
+        int id = dfaAccepts.size();
+        ids[set] = id;
+        int rule = -1;
+        for (int s : set) {
+            if (accepting[s] != -1) {
+                rule = accepting[s];
+                break;
+            }
+        }
+        dfaAccepts.push_back(rule);
+        dfaTransitions.resize(dfaTransitions.size() + 256, 0);
+        pending.push_back(set);
+        return id;
+    };
+
+    vector<int> startSet(offsets);
+    state.dfaStart = addState(startSet);
+    while (!pending.empty()) {
+        vector<int> current = pending.back();
+        pending.pop_back();
+        int id = ids[current];
+        vector<vector<int>> next(256);
+        for (int s : current) {
+            for (auto &move : moves[s]) next[move.first].push_back(move.second);
+        }
+        for (int c = 0 ; c < 256 ; c++) {
+            if (next[c].empty()) continue;
+            sort(next[c].begin(), next[c].end());
+            next[c].erase(unique(next[c].begin(), next[c].end()), next[c].end());
+            int nextId = addState(next[c]);
+            dfaTransitions[id * 256 + c] = nextId;
+        }
+    }
+}
+
+//Merge DFA states that recognize the same rules for every continuation (Moore's partition refinement)
+void minimizeDFA() {
+    size_t stateCount = dfaAccepts.size();
+    vector<int> group(stateCount);
+    for (size_t s = 0 ; s < stateCount ; s++) group[s] = dfaAccepts[s] + 1;   //dead state starts in the group of non-accepting states
+    size_t groupCount = 0;
+    while (true) {
+        map<vector<int>, int> signatures;
+        vector<int> newGroup(stateCount);
+        vector<int> signature(257);
+        for (size_t s = 0 ; s < stateCount ; s++) {
+            signature[0] = group[s];
+            for (int c = 0 ; c < 256 ; c++) signature[c+1] = group[dfaTransitions[s * 256 + c]];
+            auto found = signatures.emplace(signature, signatures.size()).first;
+            newGroup[s] = found->second;
+        }
+        group = newGroup;
+        if (signatures.size() == groupCount) break;
+        groupCount = signatures.size();
+    }
+
+    //Renumber so that the group of the dead state is state 0 again
+    vector<int> newId(groupCount, -1);
+    newId[group[0]] = 0;
+    int nextId = 1;
+    for (size_t s = 0 ; s < stateCount ; s++) if (newId[group[s]] == -1) newId[group[s]] = nextId++;
+    vector<int> newTransitions(groupCount * 256);
+    vector<int> newAccepts(groupCount);
+    for (size_t s = 0 ; s < stateCount ; s++) {
+        int id = newId[group[s]];
+        newAccepts[id] = dfaAccepts[s];
+        for (int c = 0 ; c < 256 ; c++) newTransitions[id * 256 + c] = newId[group[dfaTransitions[s * 256 + c]]];
+    }
+    for (lexState &state : lexStates) state.dfaStart = newId[group[state.dfaStart]];
+    dfaTransitions = newTransitions;
+    dfaAccepts = newAccepts;
+}
+
+const size_t MIN_MEMOIZED_SCAN = 16;    //shorter failed scans are cheaper to repeat than to remember
+
+//returns the length of the longest prefix from startP that one of the lex state's rules recognizes and sets rule to that rule
+int simulateDFA(lexJob &job, int start, size_t startP, int &rule) {
+    unordered_set<uint64_t> &failedStates = job.failedStates;
+    size_t &scanFrontier = job.scanFrontier;
+    vector<pair<int, size_t>> &scanPath = job.scanPath;
+    if (startP >= scanFrontier && !failedStates.empty()) failedStates.clear();  //nothing before startP is ever scanned again
+    const unsigned char *data = (const unsigned char*)job.input.data();
+    size_t end = job.input.length();
+    uint64_t stateCount = dfaAccepts.size();
+
+    int longest = 0;
+    rule = -1;
+    int state = start;
+    size_t currentP = startP;
+    scanPath.clear();
+    while (currentP < end) {
+        if (currentP < scanFrontier && !failedStates.empty() && failedStates.count(currentP * stateCount + state)) break;
+        scanPath.push_back(make_pair(state, currentP));
+        state = dfaTransitions[state * 256 + data[currentP]];
+        currentP++;
+        if (state == 0) break;
+        if (dfaAccepts[state] != -1) {
+            longest = currentP - startP;
+            rule = dfaAccepts[state];
+            scanPath.clear();
+        }
+    }
+
+    //Nothing was recognized after any of the pairs since the last accepting state, so a later scan can stop when it reaches one of them
+    if (scanPath.size() >= MIN_MEMOIZED_SCAN) {
+        for (auto &visited : scanPath) failedStates.insert(visited.second * stateCount + visited.first);
+    }
+    scanFrontier = max(scanFrontier, currentP);
+    markRead(job, currentP);
+    return longest;
+}
+
+//returns the index of the unit in unitNames (-1 for "-")
+int addUnit(const string &unit) {
+    if (unit == "-") return -1;
+    auto found = unitIds.find(unit);
+    if (found == unitIds.end()) {
+        found = unitIds.emplace(unit, unitNames.size()).first;
+        unitNames.push_back(unit);
+    }
+    return found->second;
+}
+
+//Write the tokens as text, one "UNIT line text" per line
+void writeTextTokens(const lexJob &job, ostream &output) {
+    for (const token &t : job.tokens) {
+        output << unitNames[t.unitId] << ' ' << t.line << ' ';
+        output.write(job.input.data() + t.offset, t.length) << '\n';
+    }
+}
+
+//Write the tokens as a binary token stream
+void writeBinaryTokens(const lexJob &job, const string &path) {
+    const vector<token> &tokens = job.tokens;
+    string names;
+    for (const string &name : unitNames) names += name + '\n';
+
+    //Intern every distinct token text as a symbol
+    string texts;
+    unordered_map<string_view, uint32_t> symbolIds;
+    vector<symbolRecord> symbols;
+    vector<tokenRecord> records;
+    records.reserve(tokens.size());
+    for (const token &t : tokens) {
+        string_view text(job.input.data() + t.offset, t.length);
+        auto found = symbolIds.find(text);
+        if (found == symbolIds.end()) {
+            found = symbolIds.emplace(text, symbols.size()).first;
+            symbols.push_back({(uint32_t)texts.length(), (uint32_t)t.length});
+            texts.append(text);
+        }
+        records.push_back({(uint16_t)t.unitId, 0, (uint32_t)t.line, found->second});
+    }
+
+    tokenStreamHeader header;
+    header.unitCount = unitNames.size();
+    header.tokenCount = tokens.size();
+    header.namesLength = names.length();
+    header.symbolCount = symbols.size();
+    header.textLength = texts.length();
+
+    ofstream output(path, ios::binary);
+    output.write((const char*)&header, sizeof(header));
+    output.write((const char*)records.data(), records.size() * sizeof(tokenRecord));
+    output.write((const char*)symbols.data(), symbols.size() * sizeof(symbolRecord));
+    output.write(names.data(), names.length());
+    output.write(texts.data(), texts.length());
+}
+
+//returns s as a JSON string
+string jsonString(const string &s) {
+    string quoted = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') quoted += '\\';
+        if ((unsigned char)c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            quoted += escaped;
+        }
+        else quoted += c;
+    }
+    return quoted + '"';
+}
+
+//Sum the counters of all jobs and write them as JSON
+void writeStats(const vector<lexJob> &jobs, const string &path) {
+    vector<lexStateStats> total(lexStates.size());
+    for (size_t i = 0 ; i < lexStates.size() ; i++) total[i].rules.resize(lexStates[i].automatas.size());
+    for (const lexJob &job : jobs) {
+        for (size_t i = 0 ; i < job.stats.size() ; i++) {
+            total[i].failedScans += job.stats[i].failedScans;
+            total[i].failedNanoseconds += job.stats[i].failedNanoseconds;
+            total[i].skippedBytes += job.stats[i].skippedBytes;
+            for (size_t r = 0 ; r < job.stats[i].rules.size() ; r++) {
+                const ruleStats &from = job.stats[i].rules[r];
+                ruleStats &to = total[i].rules[r];
+                to.started += from.started;
+                to.won += from.won;
+                to.bytes += from.bytes;
+                to.nanoseconds += from.nanoseconds;
+            }
+        }
+    }
+
+    ofstream output(path);
+    output << "{\n  \"engine\": \"" << (useENFA ? "enfa" : "dfa") << "\",\n  \"lexStates\": [";
+    for (size_t i = 0 ; i < lexStates.size() ; i++) {
+        output << (i ? "," : "") << "\n    {\"name\": " << jsonString(lexStates[i].name) << ", \"failedScans\": " << total[i].failedScans << ", \"failedNanoseconds\": " << total[i].failedNanoseconds << ", \"skippedBytes\": " << total[i].skippedBytes << ", \"rules\": [";
+        for (size_t r = 0 ; r < total[i].rules.size() ; r++) {
+            const ruleOperation &ro = lexStates[i].automatas[r].second;
+            const ruleStats &rs = total[i].rules[r];
+            output << (r ? "," : "") << "\n      {\"rule\": " << r << ", \"unit\": " << jsonString(ro.UNIT_TO_ADD) << ", \"enterState\": " << jsonString(ro.ENTER_STATE);
+            output << ", \"started\": " << rs.started << ", \"won\": " << rs.won << ", \"bytes\": " << rs.bytes << ", \"nanoseconds\": " << rs.nanoseconds << '}';
+        }
+        output << "\n    ]}";
+    }
+    output << "\n  ]\n}\n";
+}
+
+//returns the index of the lex state in lexStates
+int lexStateId(const string &name) {
+    auto found = lexStateIds.find(name);
+    if (found == lexStateIds.end()) {
+        found = lexStateIds.emplace(name, lexStates.size()).first;
+        lexStates.emplace_back();
+        lexStates.back().name = name;
+    }
+    return found->second;
+}
+
+//Read the tables written by the generator
+void loadTables() {
 ////////////////
 //Read from .txt
 /*
     STARTING STATE
     LexState
+    startingCharacter1 startingCharacter2 ... (byte values of characters that can start a token, empty line if none)
+    low high terminator1 terminator2 ... (byte values describing the skip loop, empty line if none)
+    tableSize seed keywordCount (empty line if none)
+    slot host
+    literal
+    string UNIT_TO_ADD
+    bool NEW_LINE(0/1)
+    string ENTER_STATE
+    int GO_BACK
+    ... (more keywords)
     {
     automata state
     input(doesn't exist if no transitions)
@@ -96,12 +683,61 @@ int main() {
 */
     ifstream inputFile("enfa.txt");
 
-    string startingState;
-    getline(inputFile, startingState);
-
     string read;
+    getline(inputFile, read);
+    startingState = lexStateId(read);
+
     while (getline(inputFile, read)) {  //goes through all lex states
-        string lexState = read;
+        lexState &state = lexStates[lexStateId(read)];
+        getline(inputFile, read);
+        characterSet &stateStartingCharacters = state.startingCharacters;
+        if (read != "") {
+            size_t startPos = 0;
+            size_t endPos;
+            do {
+                endPos = read.find(' ', startPos);
+                stateStartingCharacters.insert(stoi(read.substr(startPos, endPos-startPos)));
+                startPos = endPos+1;
+            } while (endPos != string::npos);
+        }
+        getline(inputFile, read);
+        if (read != "") {
+            skipLoop &loop = state.loop;
+            vector<string> values;
+            size_t startPos = 0;
+            size_t endPos;
+            do {
+                endPos = read.find(' ', startPos);
+                values.push_back(read.substr(startPos, endPos-startPos));
+                startPos = endPos+1;
+            } while (endPos != string::npos);
+            loop.low = stoi(values[0]);
+            loop.high = stoi(values[1]);
+            for (size_t i = 2 ; i < values.size() ; i++) loop.terminators.push_back(stoi(values[i]));
+        }
+        getline(inputFile, read);
+        if (read != "") {
+            keywordTable &table = state.keywords;
+            stringstream ss(read);
+            size_t keywordCount;
+            ss >> table.size >> table.seed >> keywordCount;
+            table.slots.resize(table.size);
+            for (size_t i = 0 ; i < keywordCount ; i++) {
+                getline(inputFile, read);
+                size_t slot = stoi(read.substr(0, read.find(' ')));
+                keyword &k = table.slots[slot];
+                k.host = stoi(read.substr(read.find(' ') + 1));
+                getline(inputFile, k.literal);
+                replace(k.literal.begin(), k.literal.end(), (char)-9, '\n');
+                getline(inputFile, k.ro.UNIT_TO_ADD);
+                getline(inputFile, read);
+                k.ro.NEW_LINE = stoi(read);
+                getline(inputFile, k.ro.ENTER_STATE);
+                getline(inputFile, read);
+                k.ro.GO_BACK = stoi(read);
+                k.ro.unitId = addUnit(k.ro.UNIT_TO_ADD);
+            }
+        }
         while(getline(inputFile, read) && read != "-") {    //goes through all automata in lex state
             unordered_map<int, unordered_map<char, vector<int>>> transitions;
             while (getline(inputFile, read)) {  //goes through all transitions in automata
@@ -142,56 +778,507 @@ int main() {
             getline(inputFile, ro.ENTER_STATE);
             getline(inputFile, read);
             ro.GO_BACK = stoi(read);
+            ro.unitId = addUnit(ro.UNIT_TO_ADD);
             
-            automatas[lexState].push_back(make_pair(transitions, ro));
+            state.automatas.push_back(make_pair(transitions, ro));
         }
     }
 
     inputFile.close();
 
-///////////////////////////////////
-//Reading source code into a string
-    getline(cin, allInput);
-    while(getline(cin, read)) {
-        allInput += '\n' + read;
+    for (lexState &state : lexStates) {
+        for (auto &p : state.automatas) {
+            if (p.second.ENTER_STATE != "") p.second.enterState = lexStateIds[p.second.ENTER_STATE];
+        }
+        for (keyword &k : state.keywords.slots) {
+            if (k.ro.ENTER_STATE != "") k.ro.enterState = lexStateIds[k.ro.ENTER_STATE];
+        }
+        if (!useENFA) buildDFA(state);
     }
+    if (!useENFA) minimizeDFA();
+}
 
-/////////
-//Analyze
-    int currentLine = 1;
-    string currentState = startingState;
-    size_t startP = 0;  //start of the non-analyzed part in allInput
+//Read a whole source, the last newline isn't a part of it
+void readSource(istream &in, string &input) {
+    stringstream ss;
+    ss << in.rdbuf();
+    input = ss.str();
+    if (!input.empty() && input.back() == '\n') input.pop_back();
+}
+
+//Old tokens that a new analysis of an edited input can fall back in step with
+struct resync {
+    const vector<token> *tokens;
+    size_t tokenCount;  //old tokens are the first tokenCount ones
+    size_t removedLength;
+    size_t insertedLength;
+    size_t from;        //end of the edit, no token before it can be the same as before
+    size_t next = 0;    //first old token that can still be the synchronization point
+    size_t found = string::npos;    //old token at which the analysis stopped
+    int lineShift = 0;  //change of the line of every old token from found on
+};
+
+//Where the analysis of a job is between two scans
+struct lexCursor {
+    size_t startP;      //start of the non-analyzed part in the input
+    int currentState;
+    int currentLine;
+    size_t errorP;      //start of the current run of unrecognized characters (npos if there is none)
+    size_t readBefore = 0;  //job.readEnd before the current scan
+};
 
-    while (startP < allInput.length()) {
+//Make sure the job has a counter for every rule if the analysis is instrumented
+void prepareStats(lexJob &job) {
+    if (statsOutput == "" || !job.stats.empty()) return;
+    job.stats.resize(lexStates.size());
+    for (size_t i = 0 ; i < lexStates.size() ; i++) job.stats[i].rules.resize(lexStates[i].automatas.size());
+}
+
+//Skip what the lex state skips and returns true if a scan should start at cursor.startP
+//returns false at the end of the input or, with sync, as soon as an old token would be recognized again in the same lex state, since everything after it stays the same
+bool prepareScan(lexJob &job, lexCursor &cursor, resync *sync) {
+    const string &input = job.input;
+    size_t &startP = cursor.startP;
+    size_t &errorP = cursor.errorP;
+    if (startP < input.length()) {
+        lexState &state = lexStates[cursor.currentState];
+
+        //Consume the whole run of characters that the state skips at once
+        if (state.loop.low <= state.loop.high) {
+            size_t skipEnd = skipCharacters(input, startP, state.loop);
+            markRead(job, skipEnd + 1);
+            if (skipEnd != startP) {
+                if (errorP != string::npos) {
+                    reportError(job, errorP, startP);
+                    errorP = string::npos;
+                }
+                if (!job.stats.empty()) job.stats[cursor.currentState].skippedBytes += skipEnd - startP;
+                startP = skipEnd;
+            }
+        }
+    }
+
+    bool synchronized = false;
+    if (sync && startP >= sync->from && startP < input.length()) {
+        const vector<token> &old = *sync->tokens;
+        while (sync->next < sync->tokenCount && old[sync->next].offset + sync->insertedLength < startP + sync->removedLength) sync->next++;
+        if (sync->next < sync->tokenCount && old[sync->next].offset + sync->insertedLength == startP + sync->removedLength && old[sync->next].lexState == cursor.currentState) {
+            sync->found = sync->next;
+            sync->lineShift = cursor.currentLine - old[sync->next].line;
+            synchronized = true;
+        }
+    }
+    if (startP == input.length() || synchronized) {
+        if (errorP != string::npos) reportError(job, errorP, startP);
+        errorP = string::npos;
+        return false;
+    }
+    cursor.readBefore = job.readEnd;
+    return true;
+}
+
+//Act on the result of the scan at cursor.startP: longestPrefix characters recognized by rule (-1 if nothing was recognized)
+void finishScan(lexJob &job, lexCursor &cursor, int longestPrefix, int rule) {
+    const string &input = job.input;
+    size_t &startP = cursor.startP;
+    size_t &errorP = cursor.errorP;
+    lexState &state = lexStates[cursor.currentState];
+
+    if (rule != -1) {  //not error
+        if (errorP != string::npos) {
+            reportError(job, errorP, startP);
+            errorP = string::npos;
+        }
+        const ruleOperation *rop = &state.automatas[rule].second;
+        const keyword *k = findKeyword(state.keywords, rule, input, startP, longestPrefix);
+        if (k) rop = &k->ro;
+        const ruleOperation &ro = *rop;
+
+        if (ro.unitId != -1) {
+            if (ro.GO_BACK) job.tokens.push_back({ro.unitId, cursor.currentLine, startP, (size_t)ro.GO_BACK, cursor.currentState, cursor.readBefore});
+            else job.tokens.push_back({ro.unitId, cursor.currentLine, startP, (size_t)longestPrefix, cursor.currentState, cursor.readBefore});
+        }
+
+        if (!job.stats.empty()) {
+            ruleStats &rs = job.stats[cursor.currentState].rules[rule];
+            rs.won++;
+            rs.bytes += ro.GO_BACK ? ro.GO_BACK : longestPrefix;
+        }
+
+        if (ro.GO_BACK) startP += ro.GO_BACK;
+        else startP += longestPrefix;
+        
+        if (ro.NEW_LINE) cursor.currentLine++;
+        if (ro.enterState != -1) cursor.currentState = ro.enterState;
+    }
+    else {
+        //Nothing can be recognized before the next character that can start a token, so skip straight to it
+        if (errorP == string::npos) errorP = startP;
+        if (!job.stats.empty()) job.stats[cursor.currentState].failedScans++;
+        startP = findFirstInSet(input, startP+1, state.startingCharacters);
+        markRead(job, startP + 1);
+    }
+}
+
+//Tokenize job.input from the cursor on, with sync stop when back in step with the old tokens
+void analyze(lexJob &job, lexCursor cursor, resync *sync) {
+    prepareStats(job);
+    bool instrument = !job.stats.empty();
+    chrono::steady_clock::time_point scanStart;
+
+    while (prepareScan(job, cursor, sync)) {
+        lexState &state = lexStates[cursor.currentState];
         int longestPrefix = 0;  //holds the length of the longest recognized leftover input prefix
-        int longestPrefixENFA = -1;  //holds the index of the automataOperator pair which has the longestPrefix
-        for (size_t i = 0 ; i < automatas[currentState].size() ; i++) {    //simulate all ENFAs for this lexic state
-            int prefixLength = simulateENFA(automatas[currentState][i].first, startP);
-            if (prefixLength > longestPrefix) {
-                longestPrefix = prefixLength;
-                longestPrefixENFA = i;
+        int longestPrefixRule = -1;  //holds the index of the automataOperator pair which has the longestPrefix
+        if (useENFA) {
+            for (size_t i = 0 ; i < state.automatas.size() ; i++) {    //simulate all ENFAs for this lexic state
+                if (instrument) scanStart = chrono::steady_clock::now();
+                int prefixLength = simulateENFA(state.automatas[i].first, job, cursor.startP);
+                if (instrument) {
+                    ruleStats &rs = job.stats[cursor.currentState].rules[i];
+                    rs.started++;
+                    rs.nanoseconds += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - scanStart).count();
+                }
+                if (prefixLength > longestPrefix) {
+                    longestPrefix = prefixLength;
+                    longestPrefixRule = i;
+                }
             }
         }
+        else {
+            if (instrument) scanStart = chrono::steady_clock::now();
+            longestPrefix = simulateDFA(job, state.dfaStart, cursor.startP, longestPrefixRule);
+            if (instrument) {
+                lexStateStats &ls = job.stats[cursor.currentState];
+                uint64_t nanoseconds = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - scanStart).count();
+                for (ruleStats &rs : ls.rules) rs.started++;
+                if (longestPrefixRule != -1) ls.rules[longestPrefixRule].nanoseconds += nanoseconds;
+                else ls.failedNanoseconds += nanoseconds;
+            }
+        }
+        finishScan(job, cursor, longestPrefix, longestPrefixRule);
+    }
+}
+
+//Tokenize the whole job.input
+void analyze(lexJob &job) {
+    indexNewlines(job.input, job.newlines);
+    analyze(job, {0, startingState, 1, string::npos}, nullptr);
+}
+
+//Replace removedLength characters at offset with inserted and tokenize again only the part of the input the edit can change
+//The analysis restarts at the last token that didn't read anything at or after offset and stops when it is back in step with the old tokens
+void relex(lexJob &job, size_t offset, size_t removedLength, const string &inserted) {
+    size_t oldReadEnd = job.readEnd;
+    long long shift = (long long)inserted.length() - (long long)removedLength;
+    job.input.replace(offset, removedLength, inserted);
 
-        if (longestPrefixENFA != -1) {  //not error
-            ruleOperation ro = automatas[currentState][longestPrefixENFA].second;
+    //Newlines in the removed part are gone and the ones after it move
+    vector<size_t> &newlines = job.newlines;
+    auto first = lower_bound(newlines.begin(), newlines.end(), offset);
+    auto last = lower_bound(first, newlines.end(), offset + removedLength);
+    vector<size_t> insertedNewlines;
+    indexNewlines(inserted, insertedNewlines);
+    for (size_t &p : insertedNewlines) p += offset;
+    for (auto it = last ; it != newlines.end() ; it++) *it += shift;
+    size_t firstIndex = first - newlines.begin();
+    newlines.erase(first, last);
+    newlines.insert(newlines.begin() + firstIndex, insertedNewlines.begin(), insertedNewlines.end());
 
-            if (ro.UNIT_TO_ADD != "-") {
-                if (ro.GO_BACK) cout << ro.UNIT_TO_ADD << ' ' << currentLine << ' ' << allInput.substr(startP, ro.GO_BACK) << '\n';
-                else cout << ro.UNIT_TO_ADD << ' ' << currentLine << ' ' << allInput.substr(startP, longestPrefix) << '\n';   
+    //Positions of the memoized failures are no longer valid
+    job.failedStates.clear();
+    job.scanFrontier = 0;
+
+    //The new tokens and errors are first added after the old ones and then moved in place of the ones they replace
+    vector<token> &tokens = job.tokens;
+    size_t oldTokenCount = tokens.size();
+    size_t restart = partition_point(tokens.begin(), tokens.end(), [offset](const token &t) {return t.readBefore <= offset && t.offset <= offset;}) - tokens.begin();
+    size_t startP = 0;
+    int currentState = startingState;
+    int currentLine = 1;
+    job.readEnd = 0;
+    if (restart > 0) {
+        restart--;
+        startP = tokens[restart].offset;
+        currentState = tokens[restart].lexState;
+        currentLine = tokens[restart].line;
+        job.readEnd = tokens[restart].readBefore;
+    }
+    vector<pair<size_t, size_t>> &errors = job.errors;
+    size_t oldErrorCount = errors.size();
+    size_t firstError = lower_bound(errors.begin(), errors.end(), make_pair(startP, (size_t)0)) - errors.begin();
+    size_t errorP = string::npos;
+    if (firstError > 0 && errors[firstError-1].second == startP) {  //the run of errors before the restart can continue
+        firstError--;
+        errorP = errors[firstError].first;
+    }
+
+    resync sync;
+    sync.tokens = &tokens;
+    sync.tokenCount = oldTokenCount;
+    sync.removedLength = removedLength;
+    sync.insertedLength = inserted.length();
+    sync.from = offset + inserted.length();
+    sync.next = restart;
+    analyze(job, {startP, currentState, currentLine, errorP}, &sync);
+
+    size_t syncToken = oldTokenCount;
+    size_t syncError = oldErrorCount;
+    if (sync.found != string::npos) {
+        //Everything from the synchronization point on is the same as before, only moved
+        syncToken = sync.found;
+        size_t syncP = tokens[syncToken].offset;
+        syncError = lower_bound(errors.begin() + firstError, errors.begin() + oldErrorCount, make_pair(syncP, (size_t)0)) - errors.begin();
+        for (size_t i = syncToken ; i < oldTokenCount ; i++) {
+            token &t = tokens[i];
+            t.offset += shift;
+            t.line += sync.lineShift;
+            t.readBefore = max<size_t>(t.readBefore + shift, job.readEnd);
+        }
+        for (size_t i = syncError ; i < oldErrorCount ; i++) {
+            errors[i].first += shift;
+            errors[i].second += shift;
+        }
+        job.readEnd = max<size_t>(oldReadEnd + shift, job.readEnd);
+    }
+
+    vector<token> newTokens(tokens.begin() + oldTokenCount, tokens.end());
+    tokens.resize(oldTokenCount);
+    tokens.erase(tokens.begin() + restart, tokens.begin() + syncToken);
+    tokens.insert(tokens.begin() + restart, newTokens.begin(), newTokens.end());
+    vector<pair<size_t, size_t>> newErrors(errors.begin() + oldErrorCount, errors.end());
+    errors.resize(oldErrorCount);
+    errors.erase(errors.begin() + firstError, errors.begin() + syncError);
+    errors.insert(errors.begin() + firstError, newErrors.begin(), newErrors.end());
+}
+
+const int MAX_LANES = 8;
+
+//Tokenize several jobs at once by stepping one DFA walker per job in lockstep, so the transition loads of different walkers overlap
+//nextJob returns a job with its input read (nullptr when there are no more) and done is called once a job is tokenized
+void analyzeInterleaved(int lanes, const function<lexJob*()> &nextJob, const function<void(lexJob&)> &done) {
+    static const unsigned char idle = 0;   //inactive lanes read this character from DFA state 0 forever
+    lexJob *jobs[MAX_LANES] = {};
+    lexCursor cursors[MAX_LANES];
+    const unsigned char *current[MAX_LANES];    //next character of the lane's scan
+    const unsigned char *end[MAX_LANES];
+    alignas(32) int32_t states[MAX_LANES] = {};
+    alignas(32) int32_t steps[MAX_LANES] = {};      //characters read in the current scan
+    alignas(32) int32_t longest[MAX_LANES] = {};    //length of the longest recognized prefix
+    alignas(32) int32_t rules[MAX_LANES] = {};      //rule that recognized it, -1 if none
+    alignas(32) int32_t sinceAccept[MAX_LANES] = {};    //characters read since the last accepting state
+    alignas(32) int32_t advance[MAX_LANES] = {};    //1 for active lanes, 0 for idle ones
+    int activeLanes = 0;
+
+    //Start the next scan of the lane, taking a new job when its job is done (returns false if there is nothing left)
+    auto startScan = [&](int l) {
+        while (true) {
+            if (jobs[l] && prepareScan(*jobs[l], cursors[l], nullptr)) {
+                lexJob &job = *jobs[l];
+                current[l] = (const unsigned char*)job.input.data() + cursors[l].startP;
+                end[l] = (const unsigned char*)job.input.data() + job.input.length();
+                states[l] = lexStates[cursors[l].currentState].dfaStart;
+                steps[l] = longest[l] = sinceAccept[l] = 0;
+                rules[l] = -1;
+                advance[l] = 1;
+                return true;
+            }
+            if (jobs[l]) done(*jobs[l]);
+            jobs[l] = nextJob();
+            if (!jobs[l]) {
+                current[l] = &idle;
+                end[l] = nullptr;
+                states[l] = steps[l] = longest[l] = sinceAccept[l] = advance[l] = 0;
+                rules[l] = -1;
+                return false;
             }
+            indexNewlines(jobs[l]->input, jobs[l]->newlines);
+            cursors[l] = {0, startingState, 1, string::npos};
+        }
+    };
+    for (int l = 0 ; l < MAX_LANES ; l++) {
+        current[l] = &idle;
+        end[l] = nullptr;
+        rules[l] = -1;
+        if (l < lanes && startScan(l)) activeLanes++;
+    }
 
-            if (ro.GO_BACK) startP += ro.GO_BACK;
-            else startP += longestPrefix;
-            
-            if (ro.NEW_LINE) currentLine++;
-            if (ro.ENTER_STATE != "") currentState = ro.ENTER_STATE;
+    const int *transitions = dfaTransitions.data();
+    const int *accepts = dfaAccepts.data();
+    while (activeLanes > 0) {
+        //Advance every walker by one character
+        unsigned int finished = 0;  //bit l is set if the scan of lane l is over
+        alignas(32) int32_t characters[MAX_LANES];
+        for (int l = 0 ; l < MAX_LANES ; l++) {
+            characters[l] = *current[l];
+            current[l] += advance[l];
+            if (current[l] == end[l]) finished |= 1u << l;
         }
-        else {
-            cerr << allInput[startP];  
-            startP++;
+#ifdef __AVX2__
+        __m256i state = _mm256_load_si256((const __m256i*)states);
+        state = _mm256_i32gather_epi32(transitions, _mm256_add_epi32(_mm256_slli_epi32(state, 8), _mm256_load_si256((const __m256i*)characters)), 4);
+        __m256i rule = _mm256_i32gather_epi32(accepts, state, 4);
+        __m256i step = _mm256_add_epi32(_mm256_load_si256((const __m256i*)steps), _mm256_load_si256((const __m256i*)advance));
+        __m256i accepted = _mm256_cmpgt_epi32(rule, _mm256_set1_epi32(-1));
+        __m256i since = _mm256_andnot_si256(accepted, _mm256_add_epi32(_mm256_load_si256((const __m256i*)sinceAccept), _mm256_set1_epi32(1)));
+        _mm256_store_si256((__m256i*)states, state);
+        _mm256_store_si256((__m256i*)steps, step);
+        _mm256_store_si256((__m256i*)sinceAccept, since);
+        _mm256_store_si256((__m256i*)longest, _mm256_blendv_epi8(_mm256_load_si256((const __m256i*)longest), step, accepted));
+        _mm256_store_si256((__m256i*)rules, _mm256_blendv_epi8(_mm256_load_si256((const __m256i*)rules), rule, accepted));
+        __m256i over = _mm256_or_si256(_mm256_cmpeq_epi32(state, _mm256_setzero_si256()), _mm256_cmpgt_epi32(since, _mm256_set1_epi32(MIN_MEMOIZED_SCAN - 1)));
+        finished |= _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(over, _mm256_cmpgt_epi32(_mm256_load_si256((const __m256i*)advance), _mm256_setzero_si256()))));
+#else
+        for (int l = 0 ; l < MAX_LANES ; l++) {
+            if (!advance[l]) continue;
+            int state = transitions[states[l] * 256 + characters[l]];
+            states[l] = state;
+            steps[l]++;
+            if (accepts[state] != -1) {
+                longest[l] = steps[l];
+                rules[l] = accepts[state];
+                sinceAccept[l] = 0;
+            }
+            else sinceAccept[l]++;
+            if (state == 0 || sinceAccept[l] >= (int)MIN_MEMOIZED_SCAN) finished |= 1u << l;
+        }
+#endif
+
+        //Finish the scans that are over and start the next ones
+        while (finished) {
+            int l = __builtin_ctz(finished);
+            finished &= finished - 1;
+            lexJob &job = *jobs[l];
+            int longestPrefix = longest[l];
+            int rule = rules[l];
+            if (states[l] != 0 && current[l] != end[l]) {
+                //Long failing scans go to the scalar walker, which remembers failures and keeps the analysis linear
+                longestPrefix = simulateDFA(job, lexStates[cursors[l].currentState].dfaStart, cursors[l].startP, rule);
+            }
+            else markRead(job, current[l] - (const unsigned char*)job.input.data());
+            finishScan(job, cursors[l], longestPrefix, rule);
+            if (!startScan(l)) activeLanes--;
         }
     }
+}
+
+//Read the source of a job
+void readJob(lexJob &job) {
+    ifstream source(job.path, ios::binary);
+    readSource(source, job.input);
+}
+
+//Write the tokens of a job next to its source
+void writeJob(lexJob &job) {
+    if (batchBinary) writeBinaryTokens(job, job.path + ".tok");
+    else {
+        ofstream output(job.path + ".lex", ios::binary);
+        writeTextTokens(job, output);
+    }
+}
+
+//Analyze all sources on a pool of threads and write the tokens of every source next to it
+//With the DFA every thread interleaves up to laneCount sources, with the ENFAs or the instrumentation on it analyzes one at a time
+void analyzeBatch(vector<lexJob> &jobs, unsigned threadCount) {
+    atomic<size_t> nextJob(0);
+    auto worker = [&]() {
+        vector<chrono::steady_clock::time_point> starts(jobs.size());
+        if (!useENFA && statsOutput == "" && laneCount > 1) {
+            analyzeInterleaved(min(laneCount, MAX_LANES), [&]() -> lexJob* {
+                size_t i = nextJob++;
+                if (i >= jobs.size()) return nullptr;
+                starts[i] = chrono::steady_clock::now();
+                readJob(jobs[i]);
+                return &jobs[i];
+            }, [&](lexJob &job) {
+                writeJob(job);
+                job.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - starts[&job - jobs.data()]).count();
+            });
+            return;
+        }
+        size_t i;
+        while ((i = nextJob++) < jobs.size()) {
+            lexJob &job = jobs[i];
+            auto start = chrono::steady_clock::now();
+            readJob(job);
+            analyze(job);
+            writeJob(job);
+            job.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        }
+    };
+
+    vector<thread> threads;
+    for (unsigned i = 0 ; i < threadCount ; i++) threads.emplace_back(worker);
+    for (thread &t : threads) t.join();
+}
+
+int main(int argc, char *argv[]) {
+    for (int i = 1 ; i < argc ; i++) {
+        string arg = argv[i];
+        if (arg == "--enfa") useENFA = true;
+        else if (arg == "--binary" && i+1 < argc) binaryOutput = argv[++i];
+        else if (arg == "--batch") batch = true;
+        else if (arg == "--batch-binary") batchBinary = true;
+        else if (arg == "--threads" && i+1 < argc) threadCount = stoi(argv[++i]);
+        else if (arg == "--lanes" && i+1 < argc) laneCount = stoi(argv[++i]);
+        else if (arg == "--stats" && i+1 < argc) statsOutput = argv[++i];
+        else if (arg == "--edit" && i+3 < argc) {   //offset removedLength insertedText
+            edits.push_back({stoul(argv[i+1]), stoul(argv[i+2]), argv[i+3]});
+            i += 3;
+        }
+        else if (batch) {   //a source file or a directory of sources
+            if (filesystem::is_directory(arg)) {
+                for (auto &entry : filesystem::directory_iterator(arg)) {
+                    string path = entry.path().string();
+                    if (!entry.is_regular_file() || entry.path().extension() == ".lex" || entry.path().extension() == ".tok") continue;
+                    batchPaths.push_back(path);
+                }
+            }
+            else batchPaths.push_back(arg);
+        }
+    }
+
+    auto loadStart = chrono::steady_clock::now();
+    loadTables();
+    double loadMilliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - loadStart).count();
+
+    if (batch) {
+        sort(batchPaths.begin(), batchPaths.end());
+        vector<lexJob> jobs(batchPaths.size());
+        for (size_t i = 0 ; i < jobs.size() ; i++) jobs[i].path = batchPaths[i];
+
+        auto batchStart = chrono::steady_clock::now();
+        analyzeBatch(jobs, threadCount ? threadCount : max(1u, thread::hardware_concurrency()));
+        double batchMilliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - batchStart).count();
+
+        //Report: path, tokens, errors, time in milliseconds
+        size_t totalTokens = 0;
+        int totalErrors = 0;
+        for (lexJob &job : jobs) {
+            writeErrors(job, cerr, job.path + ": ");
+            cout << job.path << '\t' << job.tokens.size() << '\t' << job.errors.size() << '\t' << job.milliseconds << '\n';
+            totalTokens += job.tokens.size();
+            totalErrors += job.errors.size();
+        }
+        cout << "total " << jobs.size() << " files\t" << totalTokens << '\t' << totalErrors << '\t' << batchMilliseconds << '\n';
+        cout << "tables loaded in " << loadMilliseconds << " ms\n";
+        if (statsOutput != "") writeStats(jobs, statsOutput);
+        return 0;
+    }
+
+    vector<lexJob> jobs(1);
+    lexJob &job = jobs[0];
+    readSource(cin, job.input);
+    analyze(job);
+    for (sourceEdit &edit : edits) relex(job, min(edit.offset, job.input.length()), min(edit.removedLength, job.input.length() - min(edit.offset, job.input.length())), edit.inserted);
+    writeErrors(job, cerr, "");
+    if (statsOutput != "") writeStats(jobs, statsOutput);
+
+////////////////
+//Output tokens
+    if (binaryOutput != "") writeBinaryTokens(job, binaryOutput);
+    else writeTextTokens(job, cout);
     
     return 0;
-}
\ No newline at end of file
+}
+
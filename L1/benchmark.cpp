@@ -0,0 +1,256 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#ifdef __unix__
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+/*
+Lexer throughput benchmark, run from the L1 directory:
+    benchmark [sampleDir] [maxBytes]
+sampleDir holds test.lan and test.in (../lab1_teza/19_ppjLang_laksi by default). Inputs from 1 KB up to maxBytes (1 GB by default)
+are generated by replicating the top-level constructs of test.in and every engine mode of the analyzer is timed on them.
+MB/s and tokens/s don't include the table load time, which is measured once per engine.
+*/
+
+const std::uint64_t KB = 1024;
+const std::uint64_t ENFA_MAX = 1024 * KB;  // the ENFA simulation is far too slow for larger inputs
+const int BATCH_FILES = 16;
+
+struct runResult {
+    double seconds = 0;
+    long peakKB = -1;   // -1 if it can't be measured
+    bool ok = false;
+};
+
+// runs the command in a shell and measures its wall time and the peak RSS of the processes it started
+runResult runCommand(const std::string& command) {
+    runResult result;
+    auto start = std::chrono::steady_clock::now();
+#ifdef __unix__
+    pid_t pid = fork();
+    if (pid == 0) {
+        execl("/bin/sh", "sh", "-c", command.c_str(), (char*)nullptr);
+        _exit(127);
+    }
+    int status = 0;
+    struct rusage usage;    // covers the shell and the analyzer it waited for
+    wait4(pid, &status, 0, &usage);
+    result.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    result.peakKB = usage.ru_maxrss;
+#else
+    result.ok = system(command.c_str()) == 0;
+#endif
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+std::string quote(const fs::path& path) {
+    return "\"" + path.string() + "\"";
+}
+
+// splits the sample into top-level constructs: runs of whole lines after which no brace, comment or literal is open
+std::vector<std::string> topLevelUnits(const std::string& sample) {
+    std::vector<std::string> units;
+    std::string unit;
+    int depth = 0;
+    bool blockComment = false;
+    char literal = 0;
+    for (size_t i = 0; i < sample.length(); i++) {
+        char c = sample[i];
+        char next = i + 1 < sample.length() ? sample[i + 1] : 0;
+        unit += c;
+        if (blockComment) {
+            if (c == '*' && next == '/') {
+                blockComment = false;
+                unit += next;
+                i++;
+            }
+        } else if (literal) {
+            if (c == '\\' && next != '\n') {
+                unit += next;
+                i++;
+            } else if (c == literal || c == '\n') {
+                literal = 0;
+            }
+        } else if (c == '/' && next == '/') {
+            while (i + 1 < sample.length() && sample[i + 1] != '\n') unit += sample[++i];
+        } else if (c == '/' && next == '*') {
+            blockComment = true;
+            unit += next;
+            i++;
+        } else if (c == '"' || c == '\'') {
+            literal = c;
+        } else if (c == '{') {
+            depth++;
+        } else if (c == '}') {
+            depth--;
+        }
+        if (c == '\n' && depth <= 0 && !blockComment && !literal) {
+            units.push_back(unit);
+            unit.clear();
+            depth = 0;
+        }
+    }
+    if (!unit.empty()) units.push_back(unit + "\n");
+    return units;
+}
+
+// writes whole top-level units of the sample until the file has (close to) size bytes, returns the real size
+std::uint64_t generateInput(const std::vector<std::string>& units, std::uint64_t size, const fs::path& path) {
+    std::ofstream output(path, std::ios::binary);
+    std::string buffer;
+    std::uint64_t written = 0;
+    for (size_t i = 0; written < size; i = (i + 1) % units.size()) {
+        if (written > 0 && written + units[i].length() > size) break;
+        buffer += units[i];
+        written += units[i].length();
+        if (buffer.length() >= 1024 * KB) {
+            output.write(buffer.data(), buffer.length());
+            buffer.clear();
+        }
+    }
+    output.write(buffer.data(), buffer.length());
+    return written;
+}
+
+std::uint64_t countLines(const fs::path& path) {
+    std::ifstream input(path, std::ios::binary);
+    std::vector<char> buffer(1024 * KB);
+    std::uint64_t lines = 0;
+    while (input) {
+        input.read(buffer.data(), buffer.size());
+        std::streamsize got = input.gcount();
+        for (std::streamsize i = 0; i < got; i++) lines += buffer[i] == '\n';
+    }
+    return lines;
+}
+
+// returns the table load time in seconds (the best of a few runs) that the analyzer reports in batch mode without any sources
+double tableLoadSeconds(const fs::path& analyzer, const std::string& arguments, const fs::path& workDir) {
+    fs::path report = workDir / "load.txt";
+    double best = -1;
+    for (int i = 0; i < 5; i++) {
+        runCommand("cd analizator && " + quote(analyzer) + " --batch " + arguments + " > " + quote(report));
+        std::ifstream input(report);
+        std::string line;
+        while (std::getline(input, line)) {
+            if (line.rfind("tables loaded in ", 0) == 0) {
+                double milliseconds = std::stod(line.substr(17));
+                if (best < 0 || milliseconds < best) best = milliseconds;
+            }
+        }
+    }
+    return best / 1000;
+}
+
+std::string sizeName(std::uint64_t size) {
+    if (size >= 1024 * 1024 * KB) return std::to_string(size / (1024 * 1024 * KB)) + " GB";
+    if (size >= 1024 * KB) return std::to_string(size / (1024 * KB)) + " MB";
+    return std::to_string(size / KB) + " KB";
+}
+
+void printRow(const std::string& size, const std::string& mode, const runResult& run, double loadSeconds, std::uint64_t bytes, std::uint64_t tokens) {
+    char row[256];
+    double seconds = run.seconds - loadSeconds;
+    if (!run.ok) {
+        snprintf(row, sizeof(row), "%-8s %-16s failed", size.c_str(), mode.c_str());
+    } else if (seconds <= 0) {  // lost in the noise of the table load
+        snprintf(row, sizeof(row), "%-8s %-16s %10.3f %10s %12s %10.1f", size.c_str(), mode.c_str(), run.seconds, "-", "-", run.peakKB / 1024.0);
+    } else {
+        snprintf(row, sizeof(row), "%-8s %-16s %10.3f %10.2f %12.0f %10.1f", size.c_str(), mode.c_str(), run.seconds,
+                 bytes / seconds / 1e6, tokens / seconds, run.peakKB / 1024.0);
+    }
+    std::cout << row << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    fs::path sampleDir = argc > 1 ? argv[1] : "../lab1_teza/19_ppjLang_laksi";
+    std::uint64_t maxBytes = argc > 2 ? std::stoull(argv[2]) : 1024 * 1024 * KB;
+
+    system("g++ -O2 -march=native generator.cpp -o generator.exe");
+    system("g++ -O2 -march=native -pthread analizator/analizator.cpp -o analizator/analizator.exe");
+    fs::path generator = fs::absolute("generator.exe");
+    fs::path analyzer = fs::absolute("analizator/analizator.exe");
+    if (!runCommand(quote(generator) + " < " + quote(sampleDir / "test.lan")).ok) {
+        std::cout << "Generator failed on " << sampleDir << std::endl;
+        return 1;
+    }
+
+    std::ifstream sampleFile(sampleDir / "test.in", std::ios::binary);
+    std::stringstream ss;
+    ss << sampleFile.rdbuf();
+    std::string sample = ss.str();
+    if (!sample.empty() && sample.back() != '\n') sample += '\n';
+    std::vector<std::string> units = topLevelUnits(sample);
+    if (units.empty()) {
+        std::cout << "Nothing to replicate in " << sampleDir / "test.in" << std::endl;
+        return 1;
+    }
+
+    fs::path workDir = fs::temp_directory_path() / "ppj_lexer_benchmark";
+    fs::remove_all(workDir);
+    fs::create_directories(workDir / "batch");
+
+    double dfaLoad = tableLoadSeconds(analyzer, "", workDir);
+    double enfaLoad = tableLoadSeconds(analyzer, "--enfa", workDir);
+    std::cout << "Sample: " << sampleDir.string() << " (" << units.size() << " top-level units)" << std::endl;
+    std::cout << "Table load: DFA " << dfaLoad * 1000 << " ms, ENFA " << enfaLoad * 1000 << " ms" << std::endl;
+    std::cout << "size     mode                seconds       MB/s     tokens/s  peak RSS MB" << std::endl;
+
+    fs::path input = workDir / "input.txt";
+    fs::path output = workDir / "output.txt";
+    for (std::uint64_t size = KB; size <= maxBytes; size *= 4) {
+        std::uint64_t bytes = generateInput(units, size, input);
+        std::string name = sizeName(size);
+
+        runResult run = runCommand("cd analizator && " + quote(analyzer) + " < " + quote(input) + " > " + quote(output) + " 2> " + quote(workDir / "errors.txt"));
+        std::uint64_t tokens = countLines(output);
+        fs::remove(output);
+        printRow(name, "dfa", run, dfaLoad, bytes, tokens);
+
+        run = runCommand("cd analizator && " + quote(analyzer) + " --binary " + quote(output) + " < " + quote(input) + " 2> " + quote(workDir / "errors.txt"));
+        fs::remove(output);
+        printRow(name, "dfa binary", run, dfaLoad, bytes, tokens);
+
+        if (size <= ENFA_MAX) {
+            run = runCommand("cd analizator && " + quote(analyzer) + " --enfa < " + quote(input) + " > " + quote(output) + " 2> " + quote(workDir / "errors.txt"));
+            fs::remove(output);
+            printRow(name, "enfa", run, enfaLoad, bytes, tokens);
+        }
+
+        // the same amount of input in BATCH_FILES sources, once with a single DFA walker and once with interleaved walkers
+        fs::remove_all(workDir / "batch");
+        fs::create_directories(workDir / "batch");
+        std::uint64_t batchBytes = 0;
+        for (int i = 0; i < BATCH_FILES; i++) {
+            batchBytes += generateInput(units, size / BATCH_FILES, workDir / "batch" / ("source" + std::to_string(i) + ".txt"));
+        }
+        for (int lanes : {1, 8}) {
+            run = runCommand("cd analizator && " + quote(analyzer) + " --batch --batch-binary --threads 1 --lanes " + std::to_string(lanes) + " " +
+                             quote(workDir / "batch") + " > " + quote(workDir / "report.txt") + " 2> " + quote(workDir / "errors.txt"));
+            std::uint64_t batchTokens = 0;
+            std::ifstream report(workDir / "report.txt");
+            std::string line;
+            while (std::getline(report, line)) {
+                if (line.rfind("total ", 0) == 0) batchTokens = std::stoull(line.substr(line.find('\t') + 1));
+            }
+            for (int i = 0; i < BATCH_FILES; i++) fs::remove(workDir / "batch" / ("source" + std::to_string(i) + ".txt.tok"));
+            printRow(name, "batch " + std::to_string(lanes) + " lane" + (lanes > 1 ? "s" : ""), run, dfaLoad, batchBytes, batchTokens);
+        }
+    }
+
+    fs::remove_all(workDir);
+    return 0;
+}
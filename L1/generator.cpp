@@ -2,6 +2,8 @@
 #include <unordered_map>
 #include <vector>
 #include <fstream>
+#include <algorithm>
+#include <cstdint>
 
 using namespace std;
 
@@ -19,6 +21,30 @@ unordered_map<string, vector<pair<string, ruleOperation>>> rules;
 vector<string> units;
 unordered_map<string, vector<pair<unordered_map<int, unordered_map<char, vector<int>>>, ruleOperation>>> automatas;
 // automatas<lexStateName, listOf<pair<map<state, transition<input, listOf<newStates>>>, ruleOperation>>>
+unordered_map<string, vector<bool>> startingCharacters;  // <lexStateName, bit vector of characters that can start a token>
+
+//Characters from low to high except for the terminators are consumed by the state without doing anything
+struct skipLoop {
+    int low = 0;
+    int high = -1;  //empty range if the state doesn't have a skip loop
+    vector<int> terminators;
+};
+const int MAX_TERMINATORS = 4;
+const int MIN_SKIP_LOOP = 16;
+unordered_map<string, skipLoop> skipLoops;
+
+//Literal rules that are removed from the automatas and recognized through a perfect hash after their host rule matches
+struct keyword {
+    string literal;
+    int host;   //index of the rule (after removal) that recognizes the literal in place of this rule
+    ruleOperation ro;
+};
+struct keywordTable {
+    uint32_t size = 0;   //power of two, 0 if the state has no keywords
+    uint32_t seed = 0;
+    vector<pair<uint32_t, keyword>> slots;   //<slot, keyword>
+};
+unordered_map<string, keywordTable> keywordTables;
 
 /*
 Converting operators to single characters and removing escapes to simplify the rest of the process
@@ -161,6 +187,104 @@ pair<int, int> transform(string reg, unordered_map<int, unordered_map<char, vect
     return pair<int, int>(leftState, rightState);
 }
 
+//Add the epsilon closure of the states marked in visited to visited
+void epsilonClosure(unordered_map<int, unordered_map<char, vector<int>>> &automata, vector<bool> &visited) {
+    vector<int> stateStack;
+    for (size_t state = 0 ; state < visited.size() ; state++) if (visited[state]) stateStack.push_back(state);
+    while (!stateStack.empty()) {
+        int top = stateStack.back();
+        stateStack.pop_back();
+        auto epsilonTransition = automata[top].find(-8);
+        if (epsilonTransition == automata[top].end()) continue;
+        for (int nextState : epsilonTransition->second) {
+            if (!visited[nextState]) {
+                visited[nextState] = true;
+                stateStack.push_back(nextState);
+            }
+        }
+    }
+}
+
+//Mark every character that the automata can read as the first character of a recognized prefix
+void addStartingCharacters(unordered_map<int, unordered_map<char, vector<int>>> &automata, vector<bool> &startingCharacters) {
+    vector<bool> visited(automata.size(), false);
+    visited[0] = true;
+    epsilonClosure(automata, visited);
+
+    //Every non-epsilon transition out of the closure reads a starting character
+    for (size_t state = 0 ; state < automata.size() ; state++) {
+        if (!visited[state]) continue;
+        for (auto &transition : automata[state]) {
+            if (transition.first == -8) continue;
+            if (transition.first == -9) startingCharacters['\n'] = true;
+            else startingCharacters[(unsigned char)transition.first] = true;
+        }
+    }
+}
+
+//Mark every character that the automata accepts on its own and can't continue after
+void addSingleCharacters(unordered_map<int, unordered_map<char, vector<int>>> &automata, vector<bool> &singleCharacters) {
+    vector<bool> visited(automata.size(), false);
+    visited[0] = true;
+    epsilonClosure(automata, visited);
+
+    //Group the states reachable after reading the first character by that character
+    unordered_map<char, vector<bool>> afterFirst;
+    for (size_t state = 0 ; state < automata.size() ; state++) {
+        if (!visited[state]) continue;
+        for (auto &transition : automata[state]) {
+            if (transition.first == -8) continue;
+            vector<bool> &next = afterFirst[transition.first];
+            if (next.empty()) next.assign(automata.size(), false);
+            for (int nextState : transition.second) next[nextState] = true;
+        }
+    }
+
+    for (auto &first : afterFirst) {
+        epsilonClosure(automata, first.second);
+        if (!first.second[1]) continue;   //the character alone isn't accepted
+        bool canContinue = false;
+        for (size_t state = 0 ; state < automata.size() && !canContinue ; state++) {
+            if (!first.second[state]) continue;
+            for (auto &transition : automata[state]) {
+                if (transition.first != -8) canContinue = true;
+            }
+        }
+        if (canContinue) continue;
+        if (first.first == -9) singleCharacters['\n'] = true;
+        else singleCharacters[(unsigned char)first.first] = true;
+    }
+}
+
+//returns true if the automata accepts the whole string
+bool acceptsString(unordered_map<int, unordered_map<char, vector<int>>> &automata, const string &s) {
+    vector<bool> current(automata.size(), false);
+    current[0] = true;
+    epsilonClosure(automata, current);
+    for (char c : s) {
+        vector<bool> next(automata.size(), false);
+        for (size_t state = 0 ; state < automata.size() ; state++) {
+            if (!current[state]) continue;
+            auto transition = automata[state].find(c);
+            if (transition == automata[state].end()) continue;
+            for (int nextState : transition->second) next[nextState] = true;
+        }
+        epsilonClosure(automata, next);
+        current = next;
+    }
+    return current[1];
+}
+
+//Seeded FNV-1a, the analyzer uses the same function to look keywords up
+uint32_t keywordHash(const string &s, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    for (char c : s) {
+        h ^= (unsigned char)c;
+        h *= 16777619u;
+    }
+    return h;
+}
+
 int main() {
     string input;   //used for processing inputs
     size_t startPos, endPos;
@@ -260,11 +384,150 @@ int main() {
         }
     }
 
+//////////////////////////////////////////////////
+//Characters that can start a token in each state
+    for (auto &lexState : automatas) {
+        vector<bool> &stateStartingCharacters = startingCharacters[lexState.first];
+        stateStartingCharacters.assign(256, false);
+        for (auto &p : lexState.second) addStartingCharacters(p.first, stateStartingCharacters);
+    }
+
+/////////////////////////////////////////////////////////////////////////////
+//Skip loops - ranges of characters that a state consumes one by one without doing anything
+    for (auto &lexState : automatas) {
+        //A character can be skipped if a rule without any operations consumes it alone and no other rule can start with it
+        vector<bool> skippable(256, false);
+        vector<bool> notSkippable(256, false);
+        for (auto &p : lexState.second) {
+            const ruleOperation &ro = p.second;
+            vector<bool> ruleStarts(256, false);
+            addStartingCharacters(p.first, ruleStarts);
+            vector<bool> ruleSingles(256, false);
+            bool doesNothing = ro.UNIT_TO_ADD == "-" && !ro.NEW_LINE && ro.ENTER_STATE == "" && ro.GO_BACK == 0;
+            if (doesNothing) addSingleCharacters(p.first, ruleSingles);
+            for (int c = 0 ; c < 256 ; c++) {
+                if (ruleSingles[c]) skippable[c] = true;
+                else if (ruleStarts[c]) notSkippable[c] = true;
+            }
+        }
+        for (int c = 0 ; c < 256 ; c++) if (notSkippable[c]) skippable[c] = false;
+
+        //Find the widest range of characters with at most MAX_TERMINATORS characters inside it that can't be skipped
+        int bestLow = 0, bestHigh = -1, bestSkippable = 0;
+        int low = 0, terminators = 0, rangeSkippable = 0;
+        for (int high = 0 ; high < 256 ; high++) {
+            if (skippable[high]) rangeSkippable++;
+            else terminators++;
+            while (terminators > MAX_TERMINATORS || (low <= high && !skippable[low])) {
+                if (skippable[low]) rangeSkippable--;
+                else terminators--;
+                low++;
+            }
+            if (rangeSkippable > bestSkippable) {
+                bestLow = low;
+                bestHigh = high;
+                bestSkippable = rangeSkippable;
+            }
+        }
+        while (bestHigh >= bestLow && !skippable[bestHigh]) bestHigh--;
+
+        skipLoop &loop = skipLoops[lexState.first];
+        if (bestSkippable < MIN_SKIP_LOOP) continue;    //not worth scanning for
+        loop.low = bestLow;
+        loop.high = bestHigh;
+        for (int c = bestLow ; c <= bestHigh ; c++) if (!skippable[c]) loop.terminators.push_back(c);
+    }
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//Keywords - literal rules that are always matched by a later rule for the same string as well
+    for (auto &lexState : automatas) {
+        auto &stateAutomatas = lexState.second;
+        vector<string> literals(stateAutomatas.size());
+        vector<bool> isLiteral(stateAutomatas.size(), false);
+        for (size_t i = 0 ; i < stateAutomatas.size() ; i++) {
+            const string &reg = rules[lexState.first][i].first;
+            isLiteral[i] = !reg.empty() && none_of(reg.begin(), reg.end(), [](char c) {return c <= -2 && c >= -8;});
+            if (isLiteral[i]) literals[i] = reg;   //still with -9 for newlines, like the automatas expect
+        }
+
+        //A literal can be removed if it is the first rule to accept its string and a rule which isn't a literal accepts it too
+        vector<bool> removed(stateAutomatas.size(), false);
+        vector<vector<int>> accepting(stateAutomatas.size());
+        for (size_t i = 0 ; i < stateAutomatas.size() ; i++) {
+            if (!isLiteral[i]) continue;
+            bool acceptedByEarlier = false;
+            bool acceptedByNonLiteral = false;
+            for (size_t j = 0 ; j < stateAutomatas.size() ; j++) {
+                if (j == i || !acceptsString(stateAutomatas[j].first, literals[i])) continue;
+                if (j < i) acceptedByEarlier = true;
+                if (!isLiteral[j]) acceptedByNonLiteral = true;
+                accepting[i].push_back(j);
+            }
+            removed[i] = !acceptedByEarlier && acceptedByNonLiteral;
+        }
+
+        vector<int> newIndex(stateAutomatas.size(), -1);
+        int remaining = 0;
+        for (size_t i = 0 ; i < stateAutomatas.size() ; i++) if (!removed[i]) newIndex[i] = remaining++;
+
+        //The host is the rule that wins for the literal's string once all removed literals are gone
+        vector<keyword> keywords;
+        for (size_t i = 0 ; i < stateAutomatas.size() ; i++) {
+            if (!removed[i]) continue;
+            for (int j : accepting[i]) {
+                if (removed[j]) continue;
+                string literal = literals[i];
+                replace(literal.begin(), literal.end(), (char)-9, '\n');
+                keywords.push_back({literal, newIndex[j], stateAutomatas[i].second});
+                break;
+            }
+        }
+        if (keywords.empty()) continue;
+
+        //Search for a seed that puts every keyword into its own slot
+        keywordTable &table = keywordTables[lexState.first];
+        table.size = 1;
+        while (table.size < 2 * keywords.size()) table.size *= 2;
+        while (true) {
+            bool collision = false;
+            for (table.seed = 0 ; table.seed < 100000 ; table.seed++) {
+                vector<bool> used(table.size, false);
+                collision = false;
+                for (auto &k : keywords) {
+                    uint32_t slot = keywordHash(k.literal, table.seed) & (table.size - 1);
+                    if (used[slot]) {
+                        collision = true;
+                        break;
+                    }
+                    used[slot] = true;
+                }
+                if (!collision) break;
+            }
+            if (!collision) break;
+            table.size *= 2;
+        }
+        for (auto &k : keywords) table.slots.push_back(make_pair(keywordHash(k.literal, table.seed) & (table.size - 1), k));
+
+        vector<pair<unordered_map<int, unordered_map<char, vector<int>>>, ruleOperation>> remainingAutomatas;
+        for (size_t i = 0 ; i < stateAutomatas.size() ; i++) if (!removed[i]) remainingAutomatas.push_back(stateAutomatas[i]);
+        stateAutomatas = remainingAutomatas;
+    }
+
 /////////////////
 //Convert to .txt
 /*
     STARTING STATE
     LexState
+    startingCharacter1 startingCharacter2 ... (byte values of characters that can start a token, empty line if none)
+    low high terminator1 terminator2 ... (byte values describing the skip loop, empty line if none)
+    tableSize seed keywordCount (empty line if none)
+    slot host
+    literal
+    string UNIT_TO_ADD
+    bool NEW_LINE(0/1)
+    string ENTER_STATE
+    int GO_BACK
+    ... (more keywords)
     {
     automata state
     input(doesn't exist if no transitions)
@@ -284,7 +547,30 @@ int main() {
     output << firstState;
 
     for (auto lexState : automatas) {
-        output << '\n' << lexState.first;
+        output << '\n' << lexState.first << '\n';
+        bool isFirstCharacter = true;
+        for (int c = 0 ; c < 256 ; c++) {
+            if (!startingCharacters[lexState.first][c]) continue;
+            if (!isFirstCharacter) output << ' ';
+            output << c;
+            isFirstCharacter = false;
+        }
+        output << '\n';
+        skipLoop &loop = skipLoops[lexState.first];
+        if (loop.low <= loop.high) {
+            output << loop.low << ' ' << loop.high;
+            for (int terminator : loop.terminators) output << ' ' << terminator;
+        }
+        output << '\n';
+        keywordTable &table = keywordTables[lexState.first];
+        if (table.size) output << table.size << ' ' << table.seed << ' ' << table.slots.size();
+        for (auto &slot : table.slots) {
+            auto &ro = slot.second.ro;
+            string literal = slot.second.literal;
+            replace(literal.begin(), literal.end(), '\n', (char)-9);
+            output << '\n' << slot.first << ' ' << slot.second.host << '\n' << literal;
+            output << '\n' << ro.UNIT_TO_ADD << '\n' << ro.NEW_LINE << '\n' << ro.ENTER_STATE << '\n' << ro.GO_BACK;
+        }
         for (auto p : lexState.second) {
             output << "\n{";
             bool isFirstState = true;
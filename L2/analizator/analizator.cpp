@@ -0,0 +1,711 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <unordered_map>
+#include <string_view>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#ifdef __unix__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "../grammar.h"
+
+using namespace std;
+
+/*
+LR(1) parser: reads the uniform characters of L1 (UNIT line text on every line, or the binary token stream with --binary)
+and writes the generative tree, every node on its own line indented by its depth, leaves as the token line and empty
+productions as $.
+The parser runs on the tables the generator leaves in ./analizator/tables.bin, mmapped and read in place. The generator run
+with --lazy leaves the grammar in ./analizator/grammar.txt instead and the automaton is built while parsing: a state gets
+its closure, actions and gotos the first time the parser reaches it and keeps them for every later parse.
+With file arguments every file is parsed into <file>.tree with the same tables or automaton.
+Parsing allocates nothing per token: the state and node stacks and the tree (nodes and their children, the children of
+a node one after another) are flat arrays that only grow, kept from one input to the next.
+*/
+
+//Same layout as parserTableHeader and productionRecord of the generator (see the format there)
+struct parserTableHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t terminalCount;
+    uint32_t nonTerminalCount;
+    uint32_t productionCount;
+    uint32_t stateCount;
+    uint32_t endTerminal;
+    uint32_t terminalWords;
+    uint32_t actionLength;
+    uint32_t gotoLength;
+    uint32_t namesLength;
+    uint32_t chainLength;
+    uint32_t unitChainLength;
+    uint32_t reserved;
+};
+
+struct productionRecord {
+    uint32_t left;
+    uint32_t length;
+};
+
+//Sections of the mapped tables
+struct parserTables {
+    const parserTableHeader* header = nullptr;
+    const uint64_t* validTerminals;
+    const uint64_t* syncTerminals;
+    const productionRecord* productions;
+    const int32_t *actionBase, *actionDefault, *actionCheck, *actionValue;
+    const int32_t *gotoBase, *gotoDefault, *gotoCheck, *gotoValue;
+    const int32_t *chainBase, *chainCheck, *chainValue, *unitChains;
+};
+
+//Same layout as the binary token stream of the L1 analyzer (see the format there)
+struct tokenStreamHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t unitCount;
+    uint32_t tokenCount;
+    uint32_t namesLength;
+    uint32_t symbolCount;
+    uint64_t textLength;
+};
+
+struct tokenRecord {
+    uint16_t unitId;
+    uint16_t reserved;
+    uint32_t line;
+    uint32_t symbol;
+};
+
+struct symbolRecord {
+    uint32_t offset;
+    uint32_t length;
+};
+
+//A file mmapped read-only where that's possible and read into memory otherwise, 8 byte aligned either way
+struct mappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+    vector<uint64_t> buffer;
+    bool mapped = false;
+
+    bool open(const string& path) {
+#ifdef __unix__
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        bool ok = map(fd);
+        ::close(fd);
+        if (ok) return true;
+#endif
+        FILE* input = fopen(path.c_str(), "rb");
+        if (!input) return false;
+        read(input);
+        fclose(input);
+        return true;
+    }
+
+    //Standard input, mapped if it's redirected from a file
+    void openStandardInput() {
+#ifdef __unix__
+        if (map(0)) return;
+#endif
+        read(stdin);
+    }
+
+    bool map(int fd) {
+#ifdef __unix__
+        struct stat info;
+        if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) return false;
+        void* address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) return false;
+        madvise(address, info.st_size, MADV_SEQUENTIAL);
+        data = (const char*)address;
+        size = info.st_size;
+        mapped = true;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void read(FILE* input) {
+        buffer.assign(1 << 17, 0);
+        size = 0;
+        while (true) {
+            if (size == buffer.size() * 8) buffer.resize(buffer.size() * 2);
+            size_t got = fread((char*)buffer.data() + size, 1, buffer.size() * 8 - size, input);
+            if (!got) break;
+            size += got;
+        }
+        data = (const char*)buffer.data();
+    }
+
+    ~mappedFile() {
+#ifdef __unix__
+        if (mapped) munmap((void*)data, size);
+#endif
+    }
+};
+
+//Stack in one contiguous array that doubles when it's full and is never shrunk
+template <typename T>
+struct flatStack {
+    T* data = nullptr;
+    size_t size = 0;
+    size_t capacity = 0;
+
+    explicit flatStack(size_t initial = 4096) {
+        grow(initial);
+    }
+    flatStack(const flatStack&) = delete;
+    ~flatStack() {
+        free(data);
+    }
+    void grow(size_t minimum) {
+        capacity = max(minimum, capacity * 2);
+        data = (T*)realloc(data, capacity * sizeof(T));
+        if (!data) {
+            cerr << "Out of memory\n";
+            exit(1);
+        }
+    }
+    void push(T value) {
+        if (size == capacity) grow(size + 1);
+        data[size++] = value;
+    }
+    T& back() {
+        return data[size - 1];
+    }
+};
+
+struct lazyState {
+    vector<lrItem> kernel;
+    bool built = false;
+    vector<int> actions;    //by terminal: (state << 1) to shift, (production << 1 | 1) to reduce, -1 for an error
+    vector<int> gotos;      //by non-terminal, -1 if none
+};
+
+struct token {
+    int32_t terminal;   //-1 if the unit isn't a terminal of the grammar
+    int32_t unit;       //unit of a binary token stream, -1 if text is the whole input line
+    uint32_t line;
+    uint32_t length;
+    const char* text;
+};
+
+//Node of a non-terminal. Children and the node stack hold node numbers, or LEAF | token number for the leaves and EMPTY for $
+struct treeNode {
+    int32_t symbol;
+    uint32_t firstChild;    //index in the children array
+    uint32_t childCount;
+};
+
+const uint32_t LEAF = 1U << 31;
+const uint32_t EMPTY = ~0U;
+
+struct parseResult {
+    int root = -1;  //-1 if the input couldn't be parsed
+    int errors = 0;
+};
+
+//Split string by delimiter into vector
+vector<string> split(const string& str, char delimiter) {
+    vector<string> parts;
+    stringstream ss(str);
+    string token;
+
+    while (getline(ss, token, delimiter)) parts.push_back(token);
+
+    return parts;
+}
+
+//Grammar, terminals and non-terminals are numbered separately from 0 like in the tables of the generator, non-terminal 0 is q0
+vector<string> terminalNames;
+vector<string> nonTerminalNames;
+unordered_map<string, int> terminalIds;
+unordered_map<string_view, int> terminalsByName;    //views of terminalNames, to find units without copying them
+int endTerminal;
+vector<productionRecord> productionRecords;     //left sides and lengths, of the tables or of the grammar
+vector<uint64_t> syncTerminals;
+int terminalWords;
+mappedFile tableFile;
+parserTables tables;
+
+//Parsing, kept from one input to the next
+flatStack<token> tokens;
+vector<string> unitNames;       //units of a binary token stream
+flatStack<int32_t> stateStack;
+flatStack<uint32_t> nodeStack;
+flatStack<treeNode> nodes;
+flatStack<uint32_t> children;
+
+//Lazy automaton, with symbols numbered like in the generator: non-terminals first, then terminal t is nonTerminalCount + t
+int terminalCount;
+vector<uint64_t> lookaheadBits;     //interned bitsets over the terminals
+vector<int> lookaheadTable;         //open addressing, ids, -1 for an empty slot
+int lookaheadCount = 0;
+vector<lazyState> states;
+unordered_map<vector<lrItem>, int, kernelHash> stateIds;
+int statesBuilt = 0;
+
+int symbolOf(const string& name, unordered_map<string, int>& ids) {
+    auto it = ids.find(name);
+    if (it != ids.end()) return it->second;
+    int id = ids.size();
+    ids[name] = id;
+    return id;
+}
+
+const uint64_t* lookaheadSet(int id) {
+    return lookaheadBits.data() + (size_t)id * lookaheadWords;
+}
+
+size_t hashLookaheads(const uint64_t* bits) {
+    uint64_t h = 0;
+    for (int i = 0 ; i < lookaheadWords ; i++) h = (h ^ bits[i]) * 0x9e3779b97f4a7c15ULL;
+    h ^= h >> 32;
+    h *= 0xd6e8feb86659fd93ULL;
+    return h ^ (h >> 32);
+}
+
+//bits must not point into lookaheadBits, it can move
+int internLookaheads(const uint64_t* bits) {
+    if ((size_t)lookaheadCount * 2 >= lookaheadTable.size()) {
+        vector<int> table(max<size_t>(1024, lookaheadTable.size() * 2), -1);
+        for (int id = 0 ; id < lookaheadCount ; id++) {
+            size_t slot = hashLookaheads(&lookaheadBits[(size_t)id * lookaheadWords]) & (table.size() - 1);
+            while (table[slot] != -1) slot = (slot + 1) & (table.size() - 1);
+            table[slot] = id;
+        }
+        lookaheadTable = move(table);
+    }
+    size_t slot = hashLookaheads(bits) & (lookaheadTable.size() - 1);
+    for ( ; lookaheadTable[slot] != -1 ; slot = (slot + 1) & (lookaheadTable.size() - 1)) {
+        if (equal(bits, bits + lookaheadWords, &lookaheadBits[(size_t)lookaheadTable[slot] * lookaheadWords])) return lookaheadTable[slot];
+    }
+    lookaheadBits.insert(lookaheadBits.end(), bits, bits + lookaheadWords);
+    lookaheadTable[slot] = lookaheadCount;
+    return lookaheadCount++;
+}
+
+//Reads the grammar in the format of the generator's input
+bool loadGrammar(const string& path) {
+    ifstream file(path);
+    if (!file) return false;
+    string input;
+    unordered_map<string, int> nonTerminalIds;
+    unordered_map<string, int> symbolKinds;     //names on the right that aren't non-terminals are terminals
+    getline(file, input);
+    vector<string> parts = split(input, ' ');
+    symbolOf("q0", nonTerminalIds);
+    for (size_t i = 1 ; i < parts.size() ; i++) symbolOf(parts[i], nonTerminalIds);
+    getline(file, input);
+    parts = split(input, ' ');
+    for (size_t i = 1 ; i < parts.size() ; i++) if (!parts[i].empty()) symbolOf(parts[i], terminalIds);
+    endTerminal = symbolOf("%", terminalIds);
+    string sync;
+    getline(file, sync);
+    vector<string> syncNames = split(sync.substr(min<size_t>(5, sync.length())), ' ');
+
+    nonTerminalCount = nonTerminalIds.size();
+    grammar.assign(nonTerminalCount, vector<int>());
+    productions.push_back({0, {nonTerminalCount}});    //q0 -> start, right sides hold symbols numbered like in the generator
+    grammar[0].push_back(0);
+    vector<vector<string>> rights;
+    vector<int> lefts;
+    int currentNonTerminal = -1;
+    while (getline(file, input)) {
+        if (input.empty()) continue;
+        if (input[0] != ' ') currentNonTerminal = symbolOf(input, nonTerminalIds);
+        else {
+            parts = split(input.substr(1), ' ');
+            if (!parts.empty() && parts[0] == "$") parts.erase(parts.begin());
+            for (const string& part : parts) if (!nonTerminalIds.count(part)) symbolOf(part, terminalIds);
+            lefts.push_back(currentNonTerminal);
+            rights.push_back(parts);
+        }
+    }
+    nonTerminalCount = nonTerminalIds.size();
+    terminalCount = terminalIds.size();
+    nonTerminalNames.assign(nonTerminalCount, "");
+    for (auto& named : nonTerminalIds) nonTerminalNames[named.second] = named.first;
+    terminalNames.assign(terminalCount, "");
+    for (auto& named : terminalIds) terminalNames[named.second] = named.first;
+    grammar.resize(nonTerminalCount);
+    productions[0].right = {1};
+    for (size_t p = 0 ; p < rights.size() ; p++) {
+        production next = {lefts[p], {}};
+        for (const string& part : rights[p]) {
+            auto it = nonTerminalIds.find(part);
+            next.right.push_back(it != nonTerminalIds.end() ? it->second : nonTerminalCount + terminalIds[part]);
+        }
+        grammar[next.left].push_back(productions.size());
+        productions.push_back(next);
+    }
+    terminalWords = (terminalCount + 63) / 64;
+    syncTerminals.assign(terminalWords, 0);
+    for (const string& name : syncNames) {
+        auto it = terminalIds.find(name);
+        if (it != terminalIds.end()) syncTerminals[it->second / 64] |= 1ULL << (it->second % 64);
+    }
+    for (const production& p : productions) productionRecords.push_back({(uint32_t)p.left, (uint32_t)p.right.size()});
+    return true;
+}
+
+//Empty non-terminals, starts and the starts of every production suffix, with the analysis of the generator
+void prepareLazyAutomaton() {
+    lookaheadWords = ((terminalCount + 63) / 64 + 3) / 4 * 4;
+    findEmptyNonTerminals(nonTerminalCount + terminalCount);
+    findStarts();
+    findRestStarts();
+}
+
+int addState(const vector<lrItem>& kernel) {
+    auto it = stateIds.find(kernel);
+    if (it != stateIds.end()) return it->second;
+    stateIds[kernel] = states.size();
+    states.push_back({kernel, false, {}, {}});
+    return states.size() - 1;
+}
+
+//Closure of the state's kernel, its actions with the conflicts resolved like in the tables of the generator and its gotos;
+//the targets are only added as kernels
+void buildState(int state) {
+    vector<lrItem> items = closure(states[state].kernel);
+    vector<int> actions(terminalCount, -1);
+    vector<int> gotos(nonTerminalCount, -1);
+    vector<pair<int, lrItem>> moved;
+    for (const lrItem& item : items) {
+        const vector<int>& right = productions[item.production].right;
+        if (item.dot < (int)right.size()) {
+            moved.push_back({right[item.dot], {item.production, item.dot + 1, item.lookaheads}});
+            continue;
+        }
+        const uint64_t* terminals = lookaheadSet(item.lookaheads);
+        for (int terminal = 0 ; terminal < terminalCount ; terminal++) {
+            if (!(terminals[terminal / 64] >> (terminal % 64) & 1)) continue;
+            addReduce(actions[terminal], item.production);
+        }
+    }
+    stable_sort(moved.begin(), moved.end(), [](const pair<int, lrItem>& a, const pair<int, lrItem>& b) { return a.first < b.first; });
+    for (size_t i = 0 ; i < moved.size() ; ) {
+        size_t j = i;
+        vector<lrItem> kernel;
+        for ( ; j < moved.size() && moved[j].first == moved[i].first ; j++) kernel.push_back(moved[j].second);
+        int target = addState(kernel);
+        if (isNonTerminal(moved[i].first)) gotos[moved[i].first] = target;
+        else addShift(actions[moved[i].first - nonTerminalCount], target);
+        i = j;
+    }
+    states[state].actions = move(actions);
+    states[state].gotos = move(gotos);
+    states[state].built = true;
+    statesBuilt++;
+}
+
+//Maps the tables and points the sections at their place in the file
+bool loadTables(const string& path) {
+    if (!tableFile.open(path) || tableFile.size < sizeof(parserTableHeader)) return false;
+    const parserTableHeader* header = (const parserTableHeader*)tableFile.data;
+    if (memcmp(header->magic, "PPJP", 4) != 0 || header->version != 2) {
+        cerr << "Tables of an unknown format, run the generator again\n";
+        exit(1);
+    }
+    const char* at = tableFile.data + sizeof(parserTableHeader);
+    auto section = [&at](size_t count, size_t size) {
+        const char* start = at;
+        at += (count * size + 7) / 8 * 8;
+        return start;
+    };
+    tables.header = header;
+    tables.validTerminals = (const uint64_t*)section((size_t)header->stateCount * header->terminalWords, 8);
+    tables.syncTerminals = (const uint64_t*)section(header->terminalWords, 8);
+    tables.productions = (const productionRecord*)section(header->productionCount, sizeof(productionRecord));
+    tables.actionBase = (const int32_t*)section(header->stateCount, 4);
+    tables.actionDefault = (const int32_t*)section(header->stateCount, 4);
+    tables.actionCheck = (const int32_t*)section(header->actionLength, 4);
+    tables.actionValue = (const int32_t*)section(header->actionLength, 4);
+    tables.gotoBase = (const int32_t*)section(header->stateCount, 4);
+    tables.gotoDefault = (const int32_t*)section(header->nonTerminalCount, 4);
+    tables.gotoCheck = (const int32_t*)section(header->gotoLength, 4);
+    tables.gotoValue = (const int32_t*)section(header->gotoLength, 4);
+    tables.chainBase = (const int32_t*)section(header->chainLength ? header->stateCount : 0, 4);
+    tables.chainCheck = (const int32_t*)section(header->chainLength, 4);
+    tables.chainValue = (const int32_t*)section(header->chainLength, 4);
+    tables.unitChains = (const int32_t*)section(header->unitChainLength, 4);
+    const char* names = at;
+    if (names + header->namesLength > tableFile.data + tableFile.size) {
+        cerr << "Tables are cut short, run the generator again\n";
+        exit(1);
+    }
+
+    terminalCount = header->terminalCount;
+    nonTerminalCount = header->nonTerminalCount;
+    endTerminal = header->endTerminal;
+    terminalWords = header->terminalWords;
+    for (uint32_t i = 0, start = 0 ; i < header->namesLength ; i++) {
+        if (names[i] != '\n') continue;
+        string name(names + start, i - start);
+        if (terminalNames.size() < (size_t)terminalCount) terminalNames.push_back(name);
+        else nonTerminalNames.push_back(name);
+        start = i + 1;
+    }
+    productionRecords.assign(tables.productions, tables.productions + header->productionCount);
+    syncTerminals.assign(tables.syncTerminals, tables.syncTerminals + terminalWords);
+    return true;
+}
+
+int action(int state, int terminal) {
+    if (terminal == -1) return -1;
+    if (!tables.header) {
+        if (!states[state].built) buildState(state);
+        return states[state].actions[terminal];
+    }
+    if (!(tables.validTerminals[(size_t)state * terminalWords + terminal / 64] >> (terminal % 64) & 1)) return -1;
+    int slot = tables.actionBase[state] + terminal;
+    return tables.actionCheck[slot] == terminal ? tables.actionValue[slot] : tables.actionDefault[state];
+}
+
+int gotoState(int state, int nonTerminal) {
+    if (!tables.header) {
+        if (!states[state].built) buildState(state);
+        return states[state].gotos[nonTerminal];
+    }
+    uint32_t slot = tables.gotoBase[state] + nonTerminal;
+    return slot < tables.header->gotoLength && tables.gotoCheck[slot] == nonTerminal ? tables.gotoValue[slot] : tables.gotoDefault[nonTerminal];
+}
+
+//Unit productions the tables skip before the action of the state on the terminal, -1 if none
+int unitChain(int state, int terminal) {
+    if (!tables.header || !tables.header->chainLength) return -1;
+    int slot = tables.chainBase[state] + terminal;
+    return tables.chainCheck[slot] == terminal ? tables.chainValue[slot] : -1;
+}
+
+bool isSync(int terminal) {
+    return syncTerminals[terminal / 64] >> (terminal % 64) & 1;
+}
+
+//Tokens of lines UNIT line text, they point into the input
+void readTextTokens(const char* data, size_t size) {
+    tokens.size = 0;
+    for (const char* line = data, *end = data + size ; line < end ; ) {
+        const char* lineEnd = (const char*)memchr(line, '\n', end - line);
+        if (!lineEnd) lineEnd = end;
+        size_t length = lineEnd - line;
+        if (length && line[length - 1] == '\r') length--;
+        if (length) {
+            const char* space = (const char*)memchr(line, ' ', length);
+            size_t unitLength = space ? space - line : length;
+            auto it = terminalsByName.find(string_view(line, unitLength));
+            int terminal = it != terminalsByName.end() && it->second != endTerminal ? it->second : -1;
+            uint32_t number = 0;
+            if (space) for (const char* digit = space + 1 ; digit < line + length && *digit >= '0' && *digit <= '9' ; digit++) number = number * 10 + (*digit - '0');
+            tokens.push({terminal, -1, number, (uint32_t)length, line});
+        }
+        line = lineEnd + 1;
+    }
+}
+
+//Tokens of a binary token stream of L1, they point into its texts
+bool readBinaryTokens(const char* data, size_t size) {
+    const tokenStreamHeader* header = (const tokenStreamHeader*)data;
+    if (size < sizeof(tokenStreamHeader) || memcmp(header->magic, "PPJT", 4) != 0 || header->version != 2) return false;
+    const tokenRecord* records = (const tokenRecord*)(data + sizeof(tokenStreamHeader));
+    const symbolRecord* symbols = (const symbolRecord*)(records + header->tokenCount);
+    const char* names = (const char*)(symbols + header->symbolCount);
+    const char* texts = names + header->namesLength;
+    if (texts + header->textLength > data + size) return false;
+    unitNames.clear();
+    vector<int> unitTerminals;
+    for (uint32_t i = 0, start = 0 ; i < header->namesLength ; i++) {
+        if (names[i] != '\n') continue;
+        unitNames.emplace_back(names + start, i - start);
+        auto it = terminalsByName.find(unitNames.back());
+        unitTerminals.push_back(it != terminalsByName.end() && it->second != endTerminal ? it->second : -1);
+        start = i + 1;
+    }
+    tokens.size = 0;
+    for (uint32_t i = 0 ; i < header->tokenCount ; i++) {
+        const symbolRecord& symbol = symbols[records[i].symbol];
+        tokens.push({unitTerminals[records[i].unitId], records[i].unitId, records[i].line, symbol.length, texts + symbol.offset});
+    }
+    return true;
+}
+
+//The line of the token as L1 writes it
+void appendToken(string& text, const token& t) {
+    if (t.unit == -1) {
+        text.append(t.text, t.length);
+        return;
+    }
+    text += unitNames[t.unit];
+    text += ' ';
+    text += to_string(t.line);
+    text += ' ';
+    text.append(t.text, t.length);
+}
+
+uint32_t addNode(treeNode node) {
+    if (nodes.size >= LEAF - 1) {
+        cerr << "Input too big\n";
+        exit(1);
+    }
+    nodes.push(node);
+    return nodes.size - 1;
+}
+
+//LR parsing with the recovery of the lab: after an error the input is skipped up to a sync terminal, then the stack is
+//popped down to a state with an action on it and parsing goes on from there
+parseResult parse() {
+    parseResult result;
+    stateStack.size = nodeStack.size = nodes.size = children.size = 0;
+    stateStack.push(0);
+    size_t position = 0;
+    size_t count = tokens.size;
+    while (true) {
+        int terminal = position < count ? tokens.data[position].terminal : endTerminal;
+        int state = stateStack.back();
+        int next = action(state, terminal);
+        if (next == -1) {
+            result.errors++;
+            string message = "Syntax error ";
+            if (position < count) message += "at line " + to_string(tokens.data[position].line) + ": expected";
+            else message += "at the end of the input: expected";
+            for (int t = 0 ; t < terminalCount ; t++) if (action(state, t) != -1) message += " " + terminalNames[t];
+            if (position < count) {
+                message += ", got ";
+                appendToken(message, tokens.data[position]);
+            }
+            cerr << message << '\n';
+            while (position < count && (tokens.data[position].terminal == -1 || !isSync(tokens.data[position].terminal))) position++;
+            terminal = position < count ? tokens.data[position].terminal : endTerminal;
+            if (position == count && !isSync(endTerminal)) return result;
+            while (stateStack.size && action(stateStack.back(), terminal) == -1) {
+                stateStack.size--;
+                if (nodeStack.size) nodeStack.size--;
+            }
+            if (!stateStack.size) return result;
+            continue;
+        }
+        int chain = unitChain(state, terminal);
+        if (chain != -1) {  //nodes of the skipped unit productions
+            for (const int32_t* p = tables.unitChains + chain ; *p != -1 ; p++) {
+                children.push(nodeStack.back());
+                nodeStack.back() = addNode({(int32_t)productionRecords[*p].left, (uint32_t)children.size - 1, 1});
+            }
+        }
+        if (!(next & 1)) {  //shift
+            nodeStack.push(LEAF | position);
+            stateStack.push(next >> 1);
+            position++;
+            continue;
+        }
+        int p = next >> 1;
+        if (p == 0) {   //accept
+            result.root = nodeStack.back();
+            return result;
+        }
+        uint32_t length = productionRecords[p].length;
+        uint32_t first = children.size;
+        if (length == 0) children.push(EMPTY);
+        for (uint32_t i = 0 ; i < length ; i++) children.push(nodeStack.data[nodeStack.size - length + i]);
+        nodeStack.size -= length;
+        stateStack.size -= length;
+        nodeStack.push(addNode({(int32_t)productionRecords[p].left, first, (uint32_t)(children.size - first)}));
+        stateStack.push(gotoState(stateStack.back(), productionRecords[p].left));
+    }
+}
+
+//Generative tree, iteratively since list productions make it as deep as the input is long
+void writeTree(const parseResult& result, FILE* output) {
+    if (result.root == -1) return;
+    string text;
+    flatStack<uint32_t> pending;   //node and depth, two entries for every node
+    pending.push(result.root);
+    pending.push(0);
+    while (pending.size) {
+        uint32_t depth = pending.data[--pending.size];
+        uint32_t index = pending.data[--pending.size];
+        text.append(depth, ' ');
+        if (index == EMPTY) text += '$';
+        else if (index & LEAF) appendToken(text, tokens.data[index & ~LEAF]);
+        else text += nonTerminalNames[nodes.data[index].symbol];
+        text += '\n';
+        if (index & LEAF) continue;     //EMPTY included
+        const treeNode& node = nodes.data[index];
+        for (uint32_t i = node.childCount ; i-- > 0 ; ) {
+            pending.push(children.data[node.firstChild + i]);
+            pending.push(depth + 1);
+        }
+        if (text.size() >= (1 << 20)) {
+            fwrite(text.data(), 1, text.size(), output);
+            text.clear();
+        }
+    }
+    fwrite(text.data(), 1, text.size(), output);
+}
+
+int main(int argc, char *argv[]) {
+    bool binaryInput = false;   //inputs are binary token streams of L1
+    vector<string> files;
+    for (int i = 1 ; i < argc ; i++) {
+        string arg = argv[i];
+        if (arg == "--binary") binaryInput = true;
+        else files.push_back(arg);
+    }
+
+    if (!loadTables("./tables.bin")) {
+        if (!loadGrammar("./grammar.txt")) {
+            cerr << "No tables, run the generator\n";
+            return 1;
+        }
+        prepareLazyAutomaton();
+        vector<uint64_t> end(lookaheadWords, 0);
+        end[endTerminal / 64] |= 1ULL << (endTerminal % 64);
+        addState({{0, 0, internLookaheads(end.data())}});
+    }
+    for (int t = 0 ; t < terminalCount ; t++) terminalsByName[terminalNames[t]] = t;
+
+    auto parseInput = [binaryInput](const mappedFile& input) {
+        if (!binaryInput) readTextTokens(input.data, input.size);
+        else if (!readBinaryTokens(input.data, input.size)) {
+            cerr << "Not a binary token stream\n";
+            tokens.size = 0;
+            return parseResult{-1, 1};
+        }
+        return parse();
+    };
+    if (files.empty()) {
+        mappedFile input;
+        input.openStandardInput();
+        writeTree(parseInput(input), stdout);
+        return 0;
+    }
+    for (const string& file : files) {
+        auto start = chrono::steady_clock::now();
+        mappedFile input;
+        if (!input.open(file)) {
+            cerr << "Can't read " << file << '\n';
+            continue;
+        }
+        parseResult result = parseInput(input);
+        FILE* output = fopen((file + ".tree").c_str(), "wb");
+        if (output) {
+            writeTree(result, output);
+            fclose(output);
+        }
+        double milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cout << file << '\t' << tokens.size << '\t' << result.errors << '\t' << milliseconds << '\n';
+    }
+    if (!tables.header) cout << "states built " << statesBuilt << " of " << states.size() << " found\n";
+    return 0;
+}
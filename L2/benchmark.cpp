@@ -0,0 +1,161 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#ifdef __unix__
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+/*
+Parser generator benchmark, run from the L2 directory:
+    benchmark [output] [runs]
+The generator runs on every lab2_teza grammar (test.san of every test, drugiGen.txt and udzbenikTest.txt) with canonical,
+Pager and LALR(1) states, runs times each (3 by default). The fastest run of every grammar and mode is written to output
+(benchmark.json by default) as JSON: wall time, peak RSS and the generator's --report with the time of every phase
+(reading, nullable, FIRST, cores, automaton, tables, writing), the state counts, the conflicts and the table bytes.
+*/
+
+struct runResult {
+    double seconds = 0;
+    long peakKB = -1;   // -1 if it can't be measured
+    bool ok = false;
+};
+
+struct grammarFile {
+    std::string name;
+    fs::path path;
+};
+
+// runs the command in a shell and measures its wall time and the peak RSS of the processes it started
+runResult runCommand(const std::string& command) {
+    runResult result;
+    auto start = std::chrono::steady_clock::now();
+#ifdef __unix__
+    pid_t pid = fork();
+    if (pid == 0) {
+        execl("/bin/sh", "sh", "-c", command.c_str(), (char*)nullptr);
+        _exit(127);
+    }
+    int status = 0;
+    struct rusage usage;    // covers the shell and the generator it waited for
+    wait4(pid, &status, 0, &usage);
+    result.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    result.peakKB = usage.ru_maxrss;
+#else
+    result.ok = system(command.c_str()) == 0;
+#endif
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+std::string quote(const fs::path& path) {
+    return "\"" + path.string() + "\"";
+}
+
+std::string readFile(const fs::path& path) {
+    std::ifstream input(path, std::ios::binary);
+    std::stringstream ss;
+    ss << input.rdbuf();
+    std::string text = ss.str();
+    while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) text.pop_back();
+    return text;
+}
+
+// value of a number field of the (flat part of the) report, -1 if it isn't there
+double reportNumber(const std::string& report, const std::string& field) {
+    size_t at = report.find("\"" + field + "\": ");
+    if (at == std::string::npos) return -1;
+    return std::stod(report.substr(at + field.length() + 4));
+}
+
+std::vector<grammarFile> grammarFiles(const fs::path& testDir) {
+    std::vector<grammarFile> grammars;
+    for (const auto& entry : fs::directory_iterator(testDir)) {
+        if (entry.is_directory() && fs::exists(entry.path() / "test.san")) {
+            grammars.push_back({entry.path().filename().string(), entry.path() / "test.san"});
+        }
+    }
+    for (const char* name : {"drugiGen.txt", "udzbenikTest.txt"}) {
+        if (fs::exists(testDir / name)) grammars.push_back({name, testDir / name});
+    }
+    std::sort(grammars.begin(), grammars.end(), [](const grammarFile& a, const grammarFile& b) { return a.name < b.name; });
+    return grammars;
+}
+
+std::string jsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') quoted += '\\';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+int main(int argc, char* argv[]) {
+    fs::path outputPath = argc > 1 ? argv[1] : "benchmark.json";
+    int runs = argc > 2 ? std::stoi(argv[2]) : 3;
+    const std::vector<std::pair<std::string, std::string>> modes = {{"canonical", ""}, {"pager", "--pager"}, {"lalr", "--lalr"}};
+
+    system("g++ -O2 -march=native -pthread generator.cpp -o generator.exe");
+    fs::path generator = fs::absolute("generator.exe");
+    std::vector<grammarFile> grammars = grammarFiles("../lab2_teza");
+
+    // the generator writes its tables to ./analizator of the directory it runs in
+    fs::path workDir = fs::temp_directory_path() / "ppj_parser_benchmark";
+    fs::remove_all(workDir);
+    fs::create_directories(workDir / "analizator");
+    fs::path report = workDir / "report.json";
+
+    std::ofstream output(outputPath);
+    output << "{\"runs\": " << runs << ", \"results\": [";
+    std::cout << "grammar              mode        seconds   states  table KB  peak RSS MB" << std::endl;
+    bool first = true;
+    for (const grammarFile& grammar : grammars) {
+        for (const auto& mode : modes) {
+            runResult best;
+            std::string bestReport;
+            for (int i = 0; i < runs; i++) {
+                fs::remove(report);
+                runResult run = runCommand("cd " + quote(workDir) + " && " + quote(generator) + " " + mode.second + " --report " + quote(report) +
+                                           " < " + quote(fs::absolute(grammar.path)) + " > /dev/null 2>&1");
+                if (!run.ok) {
+                    best = run;
+                    break;
+                }
+                if (!best.ok || run.seconds < best.seconds) {
+                    best = run;
+                    bestReport = readFile(report);
+                }
+            }
+
+            output << (first ? "\n" : ",\n") << "  {\"grammar\": " << jsonString(grammar.name) << ", \"mode\": \"" << mode.first
+                   << "\", \"ok\": " << (best.ok ? "true" : "false") << ", \"seconds\": " << best.seconds << ", \"peakKB\": " << best.peakKB;
+            if (best.ok) output << ", \"report\": " << bestReport;
+            output << "}";
+            first = false;
+
+            char row[256];
+            if (!best.ok) {
+                snprintf(row, sizeof(row), "%-20s %-10s failed", grammar.name.c_str(), mode.first.c_str());
+            } else {
+                snprintf(row, sizeof(row), "%-20s %-10s %8.3f %8.0f %9.1f %12.1f", grammar.name.c_str(), mode.first.c_str(), best.seconds,
+                         reportNumber(bestReport, "states"), reportNumber(bestReport, "tableBytes") / 1024, best.peakKB / 1024.0);
+            }
+            std::cout << row << std::endl;
+        }
+    }
+    output << "\n]}\n";
+
+    fs::remove_all(workDir);
+    return 0;
+}
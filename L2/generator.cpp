@@ -3,78 +3,101 @@
 #include <sstream>
 #include <fstream>
 #include <vector>
+#include <cstdint>
+#include <map>
 #include <unordered_map>
-#include <unordered_set>
-#include <stack>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <filesystem>
+#include <random>
+#include <chrono>
+#include "grammar.h"
 
 using namespace std;
+namespace fs = std::filesystem;
 
-struct enfaState {
-    string left;
-    vector<string> right;
-    int dot;
-    unordered_set<string> terminals;
-
-    bool operator==(const enfaState& other) const {
-    return 
-        left == other.left && 
-        right == other.right && 
-        dot == other.dot && 
-        terminals == other.terminals;
+//Grammar symbols are interned to dense ids: the augmented start q0 and the non-terminals first, then the terminals and the end of sequence %
+//Productions, LR(1) items and the grammar analysis are in grammar.h, shared with the lazy automaton of the analyzer; items are interned as well
+struct coreHash {
+    size_t operator()(const vector<int>& cores) const {
+        size_t h = cores.size();
+        for (int core : cores) h ^= (size_t)core + 0x9e3779b9 + (h << 6) + (h >> 2);
+        return h;
     }
 };
 
-ostream& operator<<(ostream& os, const enfaState& state) {
-    os << state.left << ": ";
-    os << "{";
-    for (size_t i = 0; i < state.right.size(); ++i) {
-        os << state.right[i];
-        if (i < state.right.size() - 1)
-            os << ", ";
-    }
-    os << "}, " << state.dot << ", ";
-    os << "{";
-    bool first = true;
-    for (const auto& terminal : state.terminals) {
-        if (!first) os << ", ";
-        os << terminal;
-        first = false;
-    }
-    os << "}";
-    return os;
-}
+struct lrState {
+    vector<lrItem> kernel;
+    vector<pair<int, int>> transitions;     //(symbol, state) sorted by symbol
+    vector<pair<int, int>> reductions;      //(production, lookahead set id) of the completed items of the closure
+    bool queued = false;                    //waiting in a work queue
+};
 
-struct enfaStateHash {
-    size_t operator()(const enfaState& state) const {
-        size_t h1 = hash<string>()(state.left);
-        size_t h2 = 0;
-        for (const auto& str : state.right)
-            h2 ^= hash<string>()(str) + 0x9e3779b9 + (h2 << 6) + (h2 >> 2);
-        size_t h3 = hash<int>()(state.dot);
-        
-        size_t h4 = 0;
-        vector<string> sortedTerminals(state.terminals.begin(), state.terminals.end());
-        sort(sortedTerminals.begin(), sortedTerminals.end());
-        for (const auto& str : sortedTerminals) {
-            h4 ^= hash<string>()(str) + 0x9e3779b9 + (h4 << 6) + (h4 >> 2);
-        }
+struct kernelShard {
+    mutex lock;
+    unordered_map<vector<lrItem>, int, kernelHash> ids;
+};
 
-        return h1 ^ (h2 << 1) ^ (h3 << 2) ^ (h4 << 3);
-    }
+//A worker takes the oldest state of its own queue and steals the oldest of another one when its own is empty
+struct workQueue {
+    mutex lock;
+    deque<int> states;
 };
 
-struct enfaStateSetHash {
-    size_t operator()(const std::unordered_set<enfaState, enfaStateHash>& set) const {
-        size_t hashValue = 0;
-        
-        // Iterate through all elements in the unordered_set
-        for (const auto& state : set) {
-            // Combine each state's hash into the overall hash value
-            hashValue ^= enfaStateHash{}(state) << 1;
-        }
-        
-        return hashValue;
-    }
+/*
+Parser tables (./analizator/tables.bin), all numbers little-endian and every section 8 byte aligned so the file can be mmapped and read in place
+    parserTableHeader
+    uint64 validTerminals[stateCount * terminalWords]   bit t of row s is set if state s has an action on terminal t
+    uint64 syncTerminals[terminalWords]
+    productionRecord productions[productionCount]       production 0 is q0 -> start, the rest in the order of the grammar
+    int32 actionBase[stateCount]
+    int32 actionDefault[stateCount]                     action for the valid terminals without an entry, -1 if there are none
+    int32 actionCheck[actionLength]                     terminal of the entry, -1 if unused
+    int32 actionValue[actionLength]
+    int32 gotoBase[stateCount]
+    int32 gotoDefault[nonTerminalCount]                 goto for the states without an entry, -1 if the non-terminal has no gotos
+    int32 gotoCheck[gotoLength]                         non-terminal of the entry, -1 if unused
+    int32 gotoValue[gotoLength]
+    int32 chainBase[stateCount]                         only if chainLength isn't 0, like the three sections after it
+    int32 chainCheck[chainLength]                       terminal of the entry, -1 if unused
+    int32 chainValue[chainLength]                       offset of the chain in unitChains
+    int32 unitChains[unitChainLength]                   productions of the chains in the order they reduce, each ended by -1
+    symbol names (namesLength bytes, the terminals and then the non-terminals, every name followed by '\n')
+Terminals and non-terminals are numbered separately from 0, in the order of the names, non-terminal 0 is q0.
+ACTION and GOTO are packed into comb vectors (row displacement): the entry of state s and terminal t is at actionBase[s] + t if
+actionCheck there is t and actionDefault[s] otherwise. GOTO is kept apart from ACTION, the most common target of every
+non-terminal becomes its default and the rest are packed the same way: the goto of state s on non-terminal A is at
+gotoBase[s] + A if gotoCheck there is A and gotoDefault[A] otherwise. No two different rows share a base, identical rows do,
+and lookups of valid terminals and of non-terminals the state has a goto on never fall outside the arrays.
+The most common reduction of every state becomes its default, so most rows keep only their shifts, and the valid terminal bits
+make sure defaults don't delay errors. An action is (state << 1) for a shift and (production << 1 | 1) for a reduction,
+reducing production 0 accepts.
+Tables generated with --skip-units have states that skip the reductions of unit productions (see skipUnitProductions), with
+--keep-unit-nodes the parser finds the chain of skipped productions of state s and terminal t at chainBase[s] + t (if
+chainCheck there is t) and puts their nodes over the top one before it takes the action.
+*/
+struct parserTableHeader {
+    char magic[4] = {'P', 'P', 'J', 'P'};
+    uint32_t version = 2;
+    uint32_t terminalCount = 0;
+    uint32_t nonTerminalCount = 0;
+    uint32_t productionCount = 0;
+    uint32_t stateCount = 0;
+    uint32_t endTerminal = 0;   //terminal number of %
+    uint32_t terminalWords = 0; //(terminalCount + 63) / 64
+    uint32_t actionLength = 0;
+    uint32_t gotoLength = 0;
+    uint32_t namesLength = 0;
+    uint32_t chainLength = 0;       //0 if the tables keep no unit chains
+    uint32_t unitChainLength = 0;
+    uint32_t reserved = 0;
+};
+
+struct productionRecord {
+    uint32_t left;      //non-terminal number
+    uint32_t length;    //symbols on the right
 };
 
 //Split string by delimiter into vector
@@ -88,240 +111,974 @@ vector<string> split(const string& str, char delimiter) {
     return parts;
 }
 
+//Options
+bool pagerMerge = false;    //merge states with the same core when Pager's weak compatibility says no new conflicts can appear
+bool lalrMerge = false;     //merge all states with the same core (LALR(1), reduce-reduce conflicts may appear)
+unsigned threadCount = 0;   //0 for one thread per core, merging always uses one thread
+string cacheDirectory;      //reuse the tables generated earlier for the same grammar and options from this directory
+bool skipUnits = false;     //skip the reductions of unit productions A -> B, the tree gets no nodes for them
+bool keepUnitNodes = false; //skip them but keep the chains in the tables, so the parser can still add their nodes
+string recursiveAscentPath; //also write a recursive-ascent parser in C++ for the grammar to this file
+string reportPath;          //write the times of the phases and the sizes of the automaton and the tables as JSON to this file
+bool lazyParsing = false;   //leave the grammar to the analyzer, which builds the states it reaches while parsing
+
 //Data structures
-vector<string> symbols;
-vector<string> terminalSymbols;
-vector<string> nonTerminalSymbols;
-unordered_map<string, vector<vector<string>>> grammar;
-vector<pair<string, vector<string>>> grammarOrder;
+vector<string> symbolNames;
+unordered_map<string, int> symbolIds;
+int endSymbol;          //id of %
+vector<int> grammarOrder;       //production numbers in the order of the input (without q0 -> start)
 string sync;
-unordered_set<string> emptyNonTerminal;
-unordered_map<string, unordered_map<string, bool>> startsWith;
-unordered_map<string, unordered_set<string>> starts;
-unordered_map<enfaState, unordered_map<string, vector<enfaState>>, enfaStateHash> enfa;
-unordered_map<enfaState, unordered_set<enfaState, enfaStateHash>, enfaStateHash> epsilonClosures;
-unordered_map<unordered_set<enfaState, enfaStateHash>, unordered_map<string, unordered_set<enfaState, enfaStateHash>>, enfaStateSetHash> dfa;
-unordered_map<unordered_set<enfaState, enfaStateHash>, unordered_map<string, tuple<char, string, vector<string>>>, enfaStateSetHash> actionTable;   //tuple<action, left, right> (right=optional)
-unordered_map<unordered_set<enfaState, enfaStateHash>, unordered_map<string, string>, enfaStateSetHash> newStateTable;
-
-void recursiveDoTransition(enfaState state) {
-    if (enfa.find(state) != enfa.end()) return;  //if we already processed this state
-    if (state.dot == state.right.size()) {enfa[state]; return;}  //if the dot is at the end then just add this state to the enfa (but it won't have any transitions)
-    enfaState newState = state;
-    //if we read the symbol on the right of the dot then we move the dot to the right of it
-    newState.dot++;
-    string symbolOnRight = state.right[state.dot];
-    enfa[state][symbolOnRight].push_back(newState);
-    recursiveDoTransition(newState);
-    //analyse non-terminal transitions after reading an epsilon
-    if (grammar.find(symbolOnRight) != grammar.end()) {
-        for (auto transition : grammar[symbolOnRight]) {
-            unordered_set<string> terminals;
-            //symbols that start the right sub-sequence
-            size_t i = state.dot + 1;
-            for (i ; i < state.right.size() ; i++) {
-                if (grammar.find(state.right[i]) != grammar.end()) {
-                    for (auto terminalToAdd : starts[state.right[i]]) terminals.insert(terminalToAdd);   //if non-terminal then add it's starts
-                }
-                else terminals.insert(state.right[i]);  //if terminal then add it directly (terminal only has itself in starts)
+//Lookahead sets and states are stored in chunks that never move, so worker threads can add them while others read theirs
+const int CHUNK_BITS = 12;
+const int MAX_CHUNKS = 1 << 16;
+//Lookahead sets are bitsets over the terminals (bit symbol - nonTerminalCount) of lookaheadWords 64 bit words each, stored one after
+//another in the lookahead chunks and interned through an open addressing table, so an item only holds the small id of its set
+uint64_t* lookaheadChunks[MAX_CHUNKS];
+int lookaheadCount = 0;
+vector<int> lookaheadTable;     //ids, -1 for an empty slot
+mutex lookaheadLock;
+//The collection is built in the state chunks, with kernels deduplicated in shards of their own lock, and then renumbered into states
+const int KERNEL_SHARDS = 64;
+lrState* stateChunks[MAX_CHUNKS];
+atomic<int> stateCount(0);
+mutex stateChunkLock;
+kernelShard kernelShards[KERNEL_SHARDS];
+unordered_map<vector<int>, vector<int>, coreHash> coreStates;  //kernel cores -> states with them, when merging
+vector<workQueue> workQueues;       //states whose transitions have to be (re)computed, one queue per thread
+atomic<int> pendingStates(0);       //queued or being expanded
+thread_local int workerIndex = 0;
+vector<lrState> states;             //the final collection
+int terminalCount;
+int terminalWords;
+vector<vector<int>> actionTable;    //dense rows by state, the action on every terminal, -1 for an error
+vector<vector<int>> gotoTable;      //dense rows by state, the goto on every non-terminal, -1 if none
+vector<vector<int>> chainTable;     //by state, empty or the offset in unitChains of the unit reductions skipped on every terminal (-1 for none)
+vector<int> unitChains;             //productions of the skipped chains in the order they reduce, every chain ended by -1
+vector<uint64_t> validTerminals;
+vector<int> actionBase, actionDefault, actionCheck, actionValue;
+vector<int> gotoBase, gotoDefault, gotoCheck, gotoValue;
+vector<int> chainBase, chainCheck, chainValue;
+int shiftReduceConflicts = 0;
+int reduceReduceConflicts = 0;
+//Report
+vector<pair<string, double>> phaseTimes;    //(phase, milliseconds) in the order they ran
+chrono::steady_clock::time_point phaseStart = chrono::steady_clock::now();
 
-                if (emptyNonTerminal.find(state.right[i]) == emptyNonTerminal.end()) break; //add the first non-empty
-            }
+int intern(const string& name) {
+    auto it = symbolIds.find(name);
+    if (it != symbolIds.end()) return it->second;
+    symbolIds[name] = symbolNames.size();
+    symbolNames.push_back(name);
+    return symbolNames.size() - 1;
+}
 
-            if (i == state.right.size() && (state.dot+1 == state.right.size() || emptyNonTerminal.find(state.right[i-1]) != emptyNonTerminal.end())) {
-                for (auto terminaltoAdd : state.terminals) terminals.insert(terminaltoAdd); //if the right sub-sequence can generate epsilon then keep the previous terminals as well
-            }
+const uint64_t* lookaheadSet(int id) {
+    return lookaheadChunks[id >> CHUNK_BITS] + (size_t)(id & ((1 << CHUNK_BITS) - 1)) * lookaheadWords;
+}
+
+size_t hashLookaheads(const uint64_t* bits) {
+    uint64_t h = 0;
+    for (int i = 0 ; i < lookaheadWords ; i++) h = (h ^ bits[i]) * 0x9e3779b97f4a7c15ULL;
+    //the multiplications only carry upwards and the table uses the low bits, so mix the high ones back in
+    h ^= h >> 32;
+    h *= 0xd6e8feb86659fd93ULL;
+    return h ^ (h >> 32);
+}
 
-            newState.left = symbolOnRight;
-            newState.right = transition;
-            newState.dot = 0;
-            newState.terminals = terminals;
+bool equalLookaheads(const uint64_t* first, const uint64_t* second) {
+    uint64_t difference = 0;
+    for (int i = 0 ; i < lookaheadWords ; i++) difference |= first[i] ^ second[i];
+    return difference == 0;
+}
 
-            enfa[state]["$"].push_back(newState);
-            recursiveDoTransition(newState);
+int internLookaheads(const uint64_t* bits) {
+    lock_guard<mutex> guard(lookaheadLock);
+    if ((size_t)lookaheadCount * 2 >= lookaheadTable.size()) {  //grow the table
+        vector<int> table(max<size_t>(1024, lookaheadTable.size() * 2), -1);
+        for (int id = 0 ; id < lookaheadCount ; id++) {
+            size_t slot = hashLookaheads(lookaheadSet(id)) & (table.size() - 1);
+            while (table[slot] != -1) slot = (slot + 1) & (table.size() - 1);
+            table[slot] = id;
         }
+        lookaheadTable = move(table);
+    }
+    size_t slot = hashLookaheads(bits) & (lookaheadTable.size() - 1);
+    for ( ; lookaheadTable[slot] != -1 ; slot = (slot + 1) & (lookaheadTable.size() - 1)) {
+        if (equalLookaheads(lookaheadSet(lookaheadTable[slot]), bits)) return lookaheadTable[slot];
     }
+    uint64_t*& chunk = lookaheadChunks[lookaheadCount >> CHUNK_BITS];
+    if (!chunk) chunk = new uint64_t[(size_t)lookaheadWords << CHUNK_BITS];
+    copy(bits, bits + lookaheadWords, chunk + (size_t)(lookaheadCount & ((1 << CHUNK_BITS) - 1)) * lookaheadWords);
+    lookaheadTable[slot] = lookaheadCount;
+    return lookaheadCount++;
 }
 
-unordered_set<enfaState, enfaStateHash> recursiveEpsilonClosure(enfaState state, unordered_set<enfaState, enfaStateHash> &visited) {
-    if (epsilonClosures.find(state) != epsilonClosures.end()) return epsilonClosures[state];
-    if (visited.find(state) != visited.end()) return unordered_set<enfaState, enfaStateHash>();
-   
-    visited.insert(state);
-    unordered_set<enfaState, enfaStateHash> newClosure = {state};
+int internTerminal(int terminal) {
+    vector<uint64_t> bits(lookaheadWords, 0);
+    bits[(terminal - nonTerminalCount) / 64] |= 1ULL << ((terminal - nonTerminalCount) % 64);
+    return internLookaheads(bits.data());
+}
 
-    for (auto newState : enfa[state]["$"]) {
-        for (auto toAdd : recursiveEpsilonClosure(newState, visited)) newClosure.insert(toAdd);
+int unionLookaheads(int first, int second) {
+    if (first == second || second == -1) return first;
+    if (first == -1) return second;
+    thread_local vector<uint64_t> bits;
+    bits.resize(lookaheadWords);
+    const uint64_t* a = lookaheadSet(first);
+    const uint64_t* b = lookaheadSet(second);
+    uint64_t added = 0;     //bits of the second set missing in the first
+    for (int i = 0 ; i < lookaheadWords ; i++) {
+        bits[i] = a[i] | b[i];
+        added |= b[i] & ~a[i];
     }
-    visited.erase(visited.find(state));
-    epsilonClosures[state] = newClosure;
-    return newClosure;
+    if (!added) return first;
+    return internLookaheads(bits.data());
 }
 
+bool lookaheadsIntersect(int first, int second) {
+    const uint64_t* a = lookaheadSet(first);
+    const uint64_t* b = lookaheadSet(second);
+    uint64_t common = 0;
+    for (int i = 0 ; i < lookaheadWords ; i++) common |= a[i] & b[i];
+    return common != 0;
+}
 
-int main() {
-//Help variables
-    string input;
-    vector<string> list;
-    vector<string> parts;
-    bool found;
-    bool change;
-    string currentNonTerminal;
+//Terminals of a lookahead set in increasing order
+vector<int> lookaheadTerminals(int id) {
+    vector<int> terminals;
+    const uint64_t* bits = lookaheadSet(id);
+    for (int i = 0 ; i < lookaheadWords ; i++) {
+        for (uint64_t word = bits[i] ; word ; word &= word - 1) terminals.push_back(nonTerminalCount + i * 64 + __builtin_ctzll(word));
+    }
+    return terminals;
+}
 
-//Reading inputs
-    getline(cin, input);    //Non-terminal symbols
-    parts = split(input, ' ');
-    list = {parts[1]};
-    grammar["q0"].push_back(list);
-    startsWith["q0"] = unordered_map<string, bool>();
-    for (size_t i = 0 ; i < parts.size() ; i++) nonTerminalSymbols.push_back(parts[i]);
-    for (size_t i = 0 ; i < parts.size() ; i++) symbols.push_back(parts[i]);
-    for (size_t i = 1 ; i < parts.size() ; i++) grammar[parts[i]] = vector<vector<string>>();  //Prepare the map
-    for (size_t i = 1 ; i < parts.size() ; i++) startsWith[parts[i]] = unordered_map<string, bool>();
-    getline(cin, input);
-    parts = split(input, ' ');
-    for (size_t i = 0 ; i < parts.size() ; i++) terminalSymbols.push_back(parts[i]);
-    for (size_t i = 0 ; i < parts.size() ; i++) symbols.push_back(parts[i]);
-    getline(cin, sync);    //Sync terminal symbols
-    sync = sync.substr(5);
-    
-    while (getline(cin, input)) {   //Productions
-        if (input == "!") break;    //ERR
-        if (input[0] != ' ') currentNonTerminal = input;
-        else {
-            parts = split(input.substr(1), ' ');
-            if (parts[0] == "$") parts.erase(parts.begin());
-            grammarOrder.push_back(make_pair(currentNonTerminal, parts));
-            grammar[currentNonTerminal].push_back(parts);
+ostream& operator<<(ostream& os, const lrItem& item) {
+    const production& p = productions[item.production];
+    os << symbolNames[p.left] << ": ";
+    os << "{";
+    for (size_t i = 0; i < p.right.size(); ++i) {
+        os << symbolNames[p.right[i]];
+        if (i < p.right.size() - 1)
+            os << ", ";
+    }
+    os << "}, " << item.dot << ", ";
+    os << "{";
+    bool first = true;
+    for (int terminal : lookaheadTerminals(item.lookaheads)) {
+        if (!first) os << ", ";
+        os << symbolNames[terminal];
+        first = false;
+    }
+    os << "}";
+    return os;
+}
 
+//Pager's weak compatibility of two kernels with the same core: merging them can't add a reduce-reduce conflict that
+//neither of them has, unless for some items i != j the lookaheads of i in one meet the lookaheads of j in the other
+//while neither kernel already has i and j sharing lookaheads
+bool weaklyCompatible(const vector<lrItem>& first, const vector<lrItem>& second) {
+    if (lalrMerge) return true;
+    for (size_t i = 0 ; i < first.size() ; i++) {
+        for (size_t j = i + 1 ; j < first.size() ; j++) {
+            if (!lookaheadsIntersect(first[i].lookaheads, second[j].lookaheads) &&
+                !lookaheadsIntersect(second[i].lookaheads, first[j].lookaheads)) continue;
+            if (lookaheadsIntersect(first[i].lookaheads, first[j].lookaheads)) continue;
+            if (lookaheadsIntersect(second[i].lookaheads, second[j].lookaheads)) continue;
+            return false;
         }
     }
+    return true;
+}
+
+lrState& stateAt(int id) {
+    return stateChunks[id >> CHUNK_BITS][id & ((1 << CHUNK_BITS) - 1)];
+}
+
+kernelShard& shardOf(const vector<lrItem>& kernel) {
+    return kernelShards[kernelHash()(kernel) % KERNEL_SHARDS];
+}
+
+int newState(const vector<lrItem>& kernel) {
+    int id = stateCount++;
+    {
+        lock_guard<mutex> guard(stateChunkLock);
+        lrState*& chunk = stateChunks[id >> CHUNK_BITS];
+        if (!chunk) chunk = new lrState[1 << CHUNK_BITS];
+    }
+    stateAt(id).kernel = kernel;
+    return id;
+}
 
-//Empty non-terminal symbols
-//unordered_set<string> emptyNonTerminal;
-    for (auto nonTerminal : grammar) {
-        for (auto production : nonTerminal.second) {
-            if (production.size() == 0) {
-                emptyNonTerminal.insert(nonTerminal.first);
-                break;
-            }
+void queueState(int state) {
+    if (stateAt(state).queued) return;
+    stateAt(state).queued = true;
+    pendingStates++;
+    workQueue& queue = workQueues[workerIndex];
+    lock_guard<mutex> guard(queue.lock);
+    queue.states.push_back(state);
+}
+
+//Returns the id of the state with the kernel, queueing it if it's new
+//When merging, a compatible state with the same core takes the kernel's lookaheads instead and is expanded again if they grew
+int addState(const vector<lrItem>& kernel) {
+    kernelShard& shard = shardOf(kernel);
+    unique_lock<mutex> guard(shard.lock);
+    auto it = shard.ids.find(kernel);
+    if (it != shard.ids.end()) return it->second;
+    if (!pagerMerge && !lalrMerge) {
+        int state = newState(kernel);
+        shard.ids.emplace(kernel, state);
+        guard.unlock();
+        queueState(state);
+        return state;
+    }
+    guard.unlock();
+    //merging always runs on one thread
+    vector<int> cores;
+    for (const lrItem& item : kernel) cores.push_back(coreStart[item.production] + item.dot);
+    for (int state : coreStates[cores]) {
+        vector<lrItem>& existing = stateAt(state).kernel;
+        if (!weaklyCompatible(existing, kernel)) continue;
+        vector<lrItem> merged = existing;
+        for (size_t i = 0 ; i < kernel.size() ; i++) merged[i].lookaheads = unionLookaheads(existing[i].lookaheads, kernel[i].lookaheads);
+        if (merged != existing) {
+            shardOf(existing).ids.erase(existing);
+            existing = merged;
+            shardOf(existing).ids.emplace(existing, state);
+            queueState(state);
         }
+        return state;
     }
+    int state = newState(kernel);
+    shard.ids.emplace(kernel, state);
+    coreStates[cores].push_back(state);
+    queueState(state);
+    return state;
+}
 
-    change = true;
-    while (change) {
-        change = false;
-        for (auto nonTerminal : grammar) {
-            if (emptyNonTerminal.find(nonTerminal.first) != emptyNonTerminal.end()) continue; //if we know it's empty already, skip
-            for (auto production : nonTerminal.second) {
-                found = false;
-                for (auto symbol : production) {
-                    if (emptyNonTerminal.find(symbol) == emptyNonTerminal.end()) { //if a symbol on the right isn't in an empty then left isn't in an empty either
-                        found = true;
-                        break;
-                    }
-                }
-                if (!found) {
-                    emptyNonTerminal.insert(nonTerminal.first);
-                    change = true;
+//Moves the states reachable from the first one into states, numbered in breadth-first order with the transitions in symbol order.
+//That numbering doesn't depend on the order the states were found in, so it's the same for any number of threads
+//(merging can also leave some states unreachable)
+void collectStates() {
+    vector<int> newIds(stateCount, -1);
+    vector<int> order = {0};
+    newIds[0] = 0;
+    for (size_t i = 0 ; i < order.size() ; i++) {
+        for (auto transition : stateAt(order[i]).transitions) {
+            if (newIds[transition.second] != -1) continue;
+            newIds[transition.second] = order.size();
+            order.push_back(transition.second);
+        }
+    }
+    states.clear();
+    for (int state : order) {
+        states.push_back(move(stateAt(state)));
+        for (auto& transition : states.back().transitions) transition.second = newIds[transition.second];
+    }
+    for (int chunk = 0 ; chunk < MAX_CHUNKS && stateChunks[chunk] ; chunk++) {
+        delete[] stateChunks[chunk];
+        stateChunks[chunk] = nullptr;
+    }
+    stateCount = 0;
+}
+
+//Computes the closure of the state's kernel, its reductions and its transitions (goto kernels) on every symbol
+void expandState(int state) {
+    lrState& current = stateAt(state);
+    vector<lrItem> items = closure(current.kernel);
+    current.transitions.clear();
+    current.reductions.clear();
+    vector<pair<int, lrItem>> moved;    //(symbol after the dot, item with the dot moved over it)
+    for (const lrItem& item : items) {
+        const vector<int>& right = productions[item.production].right;
+        if (item.dot == (int)right.size()) current.reductions.push_back({item.production, item.lookaheads});
+        else moved.push_back({right[item.dot], {item.production, item.dot + 1, item.lookaheads}});
+    }
+    //stable sort keeps the items of every goto kernel sorted by (production, dot)
+    stable_sort(moved.begin(), moved.end(), [](const pair<int, lrItem>& a, const pair<int, lrItem>& b) { return a.first < b.first; });
+    for (size_t i = 0 ; i < moved.size() ; ) {
+        size_t j = i;
+        vector<lrItem> kernel;
+        for ( ; j < moved.size() && moved[j].first == moved[i].first ; j++) kernel.push_back(moved[j].second);
+        int target = addState(kernel);
+        current.transitions.push_back({moved[i].first, target});
+        i = j;
+    }
+}
+
+void constructionWorker(int index) {
+    workerIndex = index;
+    while (pendingStates > 0) {
+        int state = -1;
+        for (size_t i = 0 ; i < workQueues.size() && state == -1 ; i++) {  //its own queue first
+            workQueue& queue = workQueues[(index + i) % workQueues.size()];
+            lock_guard<mutex> guard(queue.lock);
+            if (queue.states.empty()) continue;
+            state = queue.states.front();
+            queue.states.pop_front();
+        }
+        if (state == -1) {
+            this_thread::yield();
+            continue;
+        }
+        stateAt(state).queued = false;
+        expandState(state);
+        pendingStates--;
+    }
+}
+
+//Row displacement: every row (longest first) gets the lowest base at which none of its columns is taken and no other row starts,
+//identical rows share their base. check gets the column of every used slot, so a lookup can only hit entries of its own row
+//Returns the bases, both arrays get room for every column below the extent of its row
+vector<int> packComb(const vector<vector<pair<int, int>>>& rows, const vector<int>& extents, vector<int>& check, vector<int>& value) {
+    vector<int> order(rows.size());
+    for (size_t i = 0 ; i < rows.size() ; i++) order[i] = i;
+    stable_sort(order.begin(), order.end(), [&rows](int a, int b) { return rows[a].size() > rows[b].size(); });
+    vector<int> bases(rows.size(), 0);
+    vector<bool> baseTaken;
+    map<vector<pair<int, int>>, int> placed;
+    int firstFree = 0;      //slots below are all taken
+    int length = 0;
+    for (int row : order) {
+        auto known = placed.find(rows[row]);
+        if (known != placed.end()) {
+            bases[row] = known->second;
+            length = max(length, known->second + extents[row]);
+            continue;
+        }
+        while (firstFree < (int)check.size() && check[firstFree] != -1) firstFree++;
+        int base = rows[row].empty() ? 0 : max(0, firstFree - rows[row][0].first);
+        for ( ; ; base++) {
+            if (base < (int)baseTaken.size() && baseTaken[base]) continue;
+            bool fits = true;
+            for (auto entry : rows[row]) {
+                if (base + entry.first < (int)check.size() && check[base + entry.first] != -1) {
+                    fits = false;
+                    break;
                 }
             }
+            if (fits) break;
+        }
+        bases[row] = base;
+        placed[rows[row]] = base;
+        if ((int)baseTaken.size() <= base) baseTaken.resize(base + 1, false);
+        baseTaken[base] = true;
+        length = max(length, base + extents[row]);
+        if ((int)check.size() < length) {
+            check.resize(length, -1);
+            value.resize(length, -1);
+        }
+        for (auto entry : rows[row]) {
+            check[base + entry.first] = entry.first;
+            value[base + entry.first] = entry.second;
         }
     }
+    check.resize(length, -1);
+    value.resize(length, -1);
+    return bases;
+}
 
-//Starts directly with
-//unordered_map<string, unordered_map<string, bool>> startsWith;
-    for (auto nonTerminal : grammar) {
-        for (auto production : nonTerminal.second) {
-            for (auto symbol : production) { //everything until and including first non empty is a direct start for nonTerminal
-                startsWith[nonTerminal.first][symbol] = 1;
-                if (grammar.find(symbol) == grammar.end()) starts[nonTerminal.first].insert(symbol);
-                if (emptyNonTerminal.find(symbol) == emptyNonTerminal.end()) break;
+//ACTION and GOTO with the conflicts resolved like the lazy automaton does: shift before reduce, then the production given first in the grammar
+void fillTables() {
+    terminalCount = symbolNames.size() - nonTerminalCount;
+    actionTable.assign(states.size(), vector<int>(terminalCount, -1));
+    gotoTable.assign(states.size(), vector<int>(nonTerminalCount, -1));
+    chainTable.assign(states.size(), vector<int>());
+    for (size_t state = 0 ; state < states.size() ; state++) {
+        vector<int>& row = actionTable[state];
+        for (auto reduction : states[state].reductions) {
+            for (int terminal : lookaheadTerminals(reduction.second)) {
+                reduceReduceConflicts += addReduce(row[terminal - nonTerminalCount], reduction.first);
             }
         }
+        for (auto transition : states[state].transitions) {
+            if (isNonTerminal(transition.first)) {
+                gotoTable[state][transition.first] = transition.second;
+                continue;
+            }
+            shiftReduceConflicts += addShift(row[transition.first - nonTerminalCount], transition.second);
+        }
     }
+}
 
-//Starts with
-    for (auto symbol : startsWith) startsWith[symbol.first][symbol.first] = true;
-
-    change = true;
-    while (change) {
-        change = false;
-        for (auto left : startsWith) {    //leftSymbol = leftSymbol.first
-            for (auto middle : left.second) {   //middleSymbol = middle.first
-                for (auto right : startsWith[middle.first]) {   //rightSymbol = right.first
-                    if (!startsWith[left.first][right.first]) {
-                        startsWith[left.first][right.first] = true;
-                        if (grammar.find(right.first) == grammar.end()) starts[left.first].insert(right.first);
-                        change = true;
-                    }
+//Offset of the chain in unitChains, added if it's new
+int chainOffset(const vector<int>& chain) {
+    static map<vector<int>, int> offsets;
+    auto it = offsets.find(chain);
+    if (it != offsets.end()) return it->second;
+    int offset = unitChains.size();
+    unitChains.insert(unitChains.end(), chain.begin(), chain.end());
+    unitChains.push_back(-1);
+    offsets[chain] = offset;
+    return offset;
+}
+
+//Unit productions (A -> B, B a non-terminal) are skipped by giving the goto of a state u on B, whose target would reduce them,
+//to a new state that does what the states after those reductions do: on every terminal it follows the reductions A -> B,
+//C -> A ... through the gotos of u and takes the action found at the end, and it has the gotos of all the states on the way
+//(u keeps its goto if they disagree). The node of B then stands for the whole chain, unless keepUnitNodes keeps the
+//reductions skipped on every terminal for the parser to add their nodes. States no longer reachable are dropped.
+void skipUnitProductions() {
+    vector<bool> unit(productions.size(), false);
+    for (size_t p = 1 ; p < productions.size() ; p++) unit[p] = productions[p].right.size() == 1 && isNonTerminal(productions[p].right[0]);
+    vector<vector<int>> baseGotos = gotoTable;  //targets before skipping, always states of the collection
+    map<vector<int>, int> skippingStates;       //rows of a new state -> its number
+    for (size_t u = 0 ; u < actionTable.size() ; u++) {
+        for (int symbol = 0 ; symbol < nonTerminalCount ; symbol++) {
+            int target = baseGotos[u][symbol];
+            if (target == -1) continue;
+            vector<int> actions(terminalCount), chains(terminalCount, -1), gotos(nonTerminalCount, -1);
+            vector<int> visited = {target};
+            bool skipped = false;
+            for (int terminal = 0 ; terminal < terminalCount ; terminal++) {
+                int state = target;
+                vector<int> chain;
+                while ((int)chain.size() < nonTerminalCount) {  //cyclic unit productions would never end
+                    int action = actionTable[state][terminal];
+                    if (action == -1 || !(action & 1) || !unit[action >> 1]) break;
+                    int next = baseGotos[u][productions[action >> 1].left];
+                    if (next == -1) break;
+                    chain.push_back(action >> 1);
+                    visited.push_back(state = next);
+                }
+                actions[terminal] = actionTable[state][terminal];
+                if (chain.empty() || actions[terminal] == -1) continue;     //merged states can find the error only after the chain
+                skipped = true;
+                if (keepUnitNodes) chains[terminal] = chainOffset(chain);
+            }
+            if (!skipped) continue;
+            sort(visited.begin(), visited.end());
+            visited.erase(unique(visited.begin(), visited.end()), visited.end());
+            bool compatible = true;
+            for (int state : visited) {
+                for (int other = 0 ; other < nonTerminalCount ; other++) {
+                    int next = baseGotos[state][other];
+                    if (next == -1 || gotos[other] == next) continue;
+                    if (gotos[other] != -1) compatible = false;
+                    gotos[other] = next;
                 }
             }
+            if (!compatible) continue;
+            vector<int> key = actions;
+            key.insert(key.end(), gotos.begin(), gotos.end());
+            key.insert(key.end(), chains.begin(), chains.end());
+            auto known = skippingStates.find(key);
+            if (known != skippingStates.end()) {
+                gotoTable[u][symbol] = known->second;
+                continue;
+            }
+            int state = actionTable.size();
+            skippingStates[key] = state;
+            actionTable.push_back(actions);
+            gotoTable.push_back(gotos);
+            baseGotos.push_back(gotos);
+            chainTable.push_back(keepUnitNodes ? chains : vector<int>());
+            gotoTable[u][symbol] = state;
+        }
+    }
+
+    //renumber the reachable states breadth-first
+    vector<int> numbers(actionTable.size(), -1);
+    vector<int> order = {0};
+    numbers[0] = 0;
+    auto reach = [&](int state) {
+        if (numbers[state] != -1) return;
+        numbers[state] = order.size();
+        order.push_back(state);
+    };
+    for (size_t i = 0 ; i < order.size() ; i++) {
+        for (int action : actionTable[order[i]]) if (action != -1 && !(action & 1)) reach(action >> 1);
+        for (int next : gotoTable[order[i]]) if (next != -1) reach(next);
+    }
+    vector<vector<int>> actions(order.size()), gotos(order.size()), chains(order.size());
+    for (size_t i = 0 ; i < order.size() ; i++) {
+        actions[i] = move(actionTable[order[i]]);
+        for (int& action : actions[i]) if (action != -1 && !(action & 1)) action = numbers[action >> 1] << 1;
+        gotos[i] = move(gotoTable[order[i]]);
+        for (int& next : gotos[i]) if (next != -1) next = numbers[next];
+        chains[i] = move(chainTable[order[i]]);
+    }
+    actionTable = move(actions);
+    gotoTable = move(gotos);
+    chainTable = move(chains);
+}
+
+//Default actions and gotos, then the comb vectors
+void packTables() {
+    int stateCount = actionTable.size();
+    terminalWords = (terminalCount + 63) / 64;
+    validTerminals.assign(stateCount * terminalWords, 0);
+    actionDefault.assign(stateCount, -1);
+    vector<vector<pair<int, int>>> actionRows(stateCount);  //(terminal, action) that differ from the default
+    vector<vector<pair<int, int>>> chainRows(stateCount);   //(terminal, chain offset)
+    vector<vector<pair<int, int>>> gotoColumns(nonTerminalCount);   //(state, target)
+    vector<int> actionExtents(stateCount, 0);    //one past the last valid terminal
+    for (int state = 0 ; state < stateCount ; state++) {
+        const vector<int>& row = actionTable[state];
+        for (int symbol = 0 ; symbol < nonTerminalCount ; symbol++) {
+            if (gotoTable[state][symbol] != -1) gotoColumns[symbol].push_back({state, gotoTable[state][symbol]});
+        }
+        //the most common reduction becomes the default
+        unordered_map<int, int> counts;
+        int best = 0;
+        for (int terminal = 0 ; terminal < terminalCount ; terminal++) {
+            if (row[terminal] == -1) continue;
+            validTerminals[state * terminalWords + terminal / 64] |= 1ULL << (terminal % 64);
+            actionExtents[state] = terminal + 1;
+            if (!(row[terminal] & 1)) continue;
+            int count = ++counts[row[terminal]];
+            if (count > best || (count == best && row[terminal] < actionDefault[state])) {
+                best = count;
+                actionDefault[state] = row[terminal];
+            }
+        }
+        for (int terminal = 0 ; terminal < terminalCount ; terminal++) {
+            if (row[terminal] != -1 && row[terminal] != actionDefault[state]) actionRows[state].push_back({terminal, row[terminal]});
+            if (!chainTable[state].empty() && chainTable[state][terminal] != -1) chainRows[state].push_back({terminal, chainTable[state][terminal]});
+        }
+    }
+    //the most common target of every non-terminal becomes its default
+    gotoDefault.assign(nonTerminalCount, -1);
+    for (int symbol = 0 ; symbol < nonTerminalCount ; symbol++) {
+        unordered_map<int, int> counts;
+        int best = 0;
+        for (auto entry : gotoColumns[symbol]) {
+            int count = ++counts[entry.second];
+            if (count > best || (count == best && entry.second < gotoDefault[symbol])) {
+                best = count;
+                gotoDefault[symbol] = entry.second;
+            }
         }
     }
+    //the gotos that differ from the default are packed in rows by state, like the actions
+    vector<vector<pair<int, int>>> gotoRows(stateCount);    //(non-terminal, target)
+    vector<int> gotoExtents(stateCount, 0);      //one past the last non-terminal with a goto
+    for (int symbol = 0 ; symbol < nonTerminalCount ; symbol++) {
+        for (auto entry : gotoColumns[symbol]) {
+            if (entry.second != gotoDefault[symbol]) gotoRows[entry.first].push_back({symbol, entry.second});
+            gotoExtents[entry.first] = symbol + 1;
+        }
+    }
+    actionBase = packComb(actionRows, actionExtents, actionCheck, actionValue);
+    gotoBase = packComb(gotoRows, gotoExtents, gotoCheck, gotoValue);
+    if (!unitChains.empty()) chainBase = packComb(chainRows, actionExtents, chainCheck, chainValue);
+}
 
-//ENFA
-//unordered_map<enfaState, unordered_map<string, vector<enfaState>>> enfa;
-    enfaState firstState;
-    firstState.left = "q0";
-    firstState.right = grammar["q0"][0];
-    firstState.dot = 0;
-    firstState.terminals.insert("%");   // % is the simbol for the end of sequence
+vector<uint64_t> syncTerminalBits() {
+    vector<uint64_t> bits(terminalWords, 0);
+    for (const string& name : split(sync, ' ')) {
+        auto it = symbolIds.find(name);
+        if (it == symbolIds.end() || isNonTerminal(it->second)) continue;
+        bits[(it->second - nonTerminalCount) / 64] |= 1ULL << ((it->second - nonTerminalCount) % 64);
+    }
+    return bits;
+}
 
-    recursiveDoTransition(firstState);
+template <typename T>
+void writeArray(ofstream& output, const vector<T>& values) {
+    output.write((const char*)values.data(), values.size() * sizeof(T));
+    static const char padding[8] = {};
+    output.write(padding, (8 - values.size() * sizeof(T) % 8) % 8);
+}
 
-    cout << "ENFA size: " << enfa.size() << '\n';   //ERR
+//Writes the tables in the format above, returns the size of the file
+size_t writeTables(const string& path) {
+    parserTableHeader header;
+    header.terminalCount = terminalCount;
+    header.nonTerminalCount = nonTerminalCount;
+    header.productionCount = productions.size();
+    header.stateCount = actionTable.size();
+    header.endTerminal = endSymbol - nonTerminalCount;
+    header.terminalWords = terminalWords;
+    header.actionLength = actionCheck.size();
+    header.gotoLength = gotoCheck.size();
+    header.chainLength = chainCheck.size();
+    header.unitChainLength = unitChains.size();
+    string names;
+    for (int symbol = nonTerminalCount ; symbol < (int)symbolNames.size() ; symbol++) names += symbolNames[symbol] + '\n';
+    for (int symbol = 0 ; symbol < nonTerminalCount ; symbol++) names += symbolNames[symbol] + '\n';
+    header.namesLength = names.length();
 
-//All ENFA epsilon closures
-//unordered_map<enfaState, unordered_set<enfaState>> epsilonClosures;
-    for (auto stateTransitionPair : enfa) {
-        unordered_set<enfaState, enfaStateHash> visited;
-        if (epsilonClosures.find(stateTransitionPair.first) == epsilonClosures.end()) recursiveEpsilonClosure(stateTransitionPair.first, visited);
+    vector<uint64_t> syncTerminals = syncTerminalBits();
+    vector<productionRecord> records;
+    for (const production& p : productions) records.push_back({(uint32_t)p.left, (uint32_t)p.right.size()});
+
+    ofstream output(path, ios::binary);
+    output.write((const char*)&header, sizeof(header));
+    writeArray(output, validTerminals);
+    writeArray(output, syncTerminals);
+    writeArray(output, records);
+    writeArray(output, actionBase);
+    writeArray(output, actionDefault);
+    writeArray(output, actionCheck);
+    writeArray(output, actionValue);
+    writeArray(output, gotoBase);
+    writeArray(output, gotoDefault);
+    writeArray(output, gotoCheck);
+    writeArray(output, gotoValue);
+    writeArray(output, chainBase);
+    writeArray(output, chainCheck);
+    writeArray(output, chainValue);
+    writeArray(output, unitChains);
+    output.write(names.data(), names.length());
+    return output.tellp();
+}
+
+//Fixed part of the recursive-ascent parser, the grammar constants and the state functions are written before it
+const char* recursiveAscentRuntime = R"(
+vector<token> tokens;
+size_t position = 0;
+vector<treeNode> nodes;
+vector<int> nodeStack;  //nodes of the symbols of the states whose functions are on the call stack
+int errors = 0;
+
+int lookahead() {
+    return position < tokens.size() ? tokens[position].terminal : endTerminal;
+}
+
+bool isValid(int state, int terminal) {
+    return terminal != -1 && (validTerminals[state][terminal / 64] >> (terminal % 64) & 1);
+}
+
+void shift() {
+    nodes.push_back({nonTerminalCount + tokens[position].terminal, true, (int)position, {}});
+    nodeStack.push_back(nodes.size() - 1);
+    position++;
+}
+
+//Builds the node and returns through the functions of the states the right side popped
+result reduce(int left, int length) {
+    treeNode node = {left, false, -1, {}};
+    if (length == 0) {
+        nodes.push_back({-1, true, -1, {}});
+        node.children.push_back(nodes.size() - 1);
     }
+    node.children.insert(node.children.end(), nodeStack.end() - length, nodeStack.end());
+    nodeStack.resize(nodeStack.size() - length);
+    nodes.push_back(node);
+    nodeStack.push_back(nodes.size() - 1);
+    return {left, length};
+}
 
-//ENFA -> DFA
-//unordered_map<unordered_set<enfaState, enfaStateHash>, unordered_map<string, unordered_set<enfaState, enfaStateHash>>> dfa;
-    stack<unordered_set<enfaState, enfaStateHash>> dfaStack;
-    dfaStack.push(epsilonClosures[firstState]);
-    unordered_set<enfaState, enfaStateHash> currentStateSet;
+//Node of a skipped unit production over the top one
+void wrap(int left) {
+    nodes.push_back({left, false, -1, {nodeStack.back()}});
+    nodeStack.back() = nodes.size() - 1;
+}
 
-    while (!dfaStack.empty()) {
-        currentStateSet = dfaStack.top();
-        dfaStack.pop();
+//Reports the error and skips to a sync terminal, the states are then popped by returning RECOVER until one has an action on it
+result error(int state) {
+    errors++;
+    string expected;
+    for (int t = 0 ; t < terminalCount ; t++) if (isValid(state, t)) expected += string(" ") + terminalNames[t];
+    if (position < tokens.size()) cerr << "Syntax error at line " << tokens[position].line << ": expected" << expected << ", got " << tokens[position].text << '\n';
+    else cerr << "Syntax error at the end of the input: expected" << expected << '\n';
+    while (position < tokens.size() && (tokens[position].terminal == -1 || !(syncTerminals[tokens[position].terminal / 64] >> (tokens[position].terminal % 64) & 1))) position++;
+    if (position == tokens.size() && !(syncTerminals[endTerminal / 64] >> (endTerminal % 64) & 1)) return {0, FAIL};
+    return {0, RECOVER};
+}
 
-        dfa[currentStateSet];
+//Called by a state function that gets RECOVER back: it stays if it has an action on the sync terminal, otherwise it's popped
+bool popped(int state) {
+    if (isValid(state, lookahead())) return false;
+    if (!nodeStack.empty()) nodeStack.pop_back();
+    return true;
+}
 
-        for (auto symbol : symbols) {
-            unordered_set<enfaState, enfaStateHash> newStateSet;
-            unordered_set<enfaState, enfaStateHash> newStateSetWithEpsilon;
-            for (auto state : currentStateSet) {
-                for (auto toAdd : enfa[state][symbol]) newStateSet.insert(toAdd);
-                for (auto addedState : newStateSet) for (auto toAdd : epsilonClosures[addedState]) newStateSetWithEpsilon.insert(toAdd);
-            }
-            if (dfa.find(newStateSetWithEpsilon) == dfa.end()) {
-                dfa[currentStateSet][symbol] = newStateSetWithEpsilon;
-                dfaStack.push(newStateSetWithEpsilon);
+int main() {
+    unordered_map<string, int> terminalIds;
+    for (int t = 0 ; t < terminalCount ; t++) terminalIds[terminalNames[t]] = t;
+    string line;
+    while (getline(cin, line)) {
+        if (line.empty()) continue;
+        size_t space = line.find(' ');
+        auto it = terminalIds.find(line.substr(0, space));
+        int number = space != string::npos ? atoi(line.c_str() + space + 1) : 0;
+        tokens.push_back({it != terminalIds.end() && it->second != endTerminal ? it->second : -1, number, line});
+    }
+    if (state0().pops != ACCEPT) return 0;
+    //generative tree, iteratively since list productions make it as deep as the input is long
+    string text;
+    vector<pair<int, int>> pending = {{nodeStack.back(), 0}};  //(node, depth)
+    while (!pending.empty()) {
+        auto [index, depth] = pending.back();
+        pending.pop_back();
+        const treeNode& node = nodes[index];
+        text.append(depth, ' ');
+        if (!node.leaf) text += nonTerminalNames[node.symbol];
+        else if (node.token == -1) text += '$';
+        else text += tokens[node.token].text;
+        text += '\n';
+        for (size_t i = node.children.size() ; i-- > 0 ; ) pending.push_back({node.children[i], depth + 1});
+    }
+    cout << text;
+    return 0;
+}
+)";
+
+//Writes a recursive-ascent parser for the tables: every state is a function with a switch on the lookahead, a shift calls
+//the function of the target, a reduction returns (left side, length) and every function it returns through decrements the
+//length until the one that reaches 0 calls the function of its goto on the left side
+void writeRecursiveAscent(const string& path) {
+    ofstream output(path);
+    output << "//Recursive-ascent parser generated by generator.cpp for a single grammar, reads the uniform characters of L1 and writes\n"
+              "//the generative tree like the analyzer\n"
+              "#include <iostream>\n#include <string>\n#include <vector>\n#include <unordered_map>\n#include <cstdint>\n#include <cstdlib>\n\n"
+              "using namespace std;\n\n"
+              "struct token {\n    int terminal;   //-1 if the unit isn't a terminal of the grammar\n    int line;\n    string text;\n};\n\n"
+              "struct treeNode {\n    int symbol;\n    bool leaf;\n    int token;      //-1 for $\n    vector<int> children;\n};\n\n"
+              "struct result {\n    int left;\n    int pops;       //state functions still to return through, or one of the codes below\n};\n\n"
+              "const int ACCEPT = -1, RECOVER = -2, FAIL = -3;\n";
+    output << "const int terminalCount = " << terminalCount << ";\n";
+    output << "const int nonTerminalCount = " << nonTerminalCount << ";\n";
+    output << "const int endTerminal = " << endSymbol - nonTerminalCount << ";\n";
+    output << "const char* terminalNames[] = {";
+    for (int t = 0 ; t < terminalCount ; t++) output << (t ? ", " : "") << '"' << symbolNames[nonTerminalCount + t] << '"';
+    output << "};\nconst char* nonTerminalNames[] = {";
+    for (int symbol = 0 ; symbol < nonTerminalCount ; symbol++) output << (symbol ? ", " : "") << '"' << symbolNames[symbol] << '"';
+    output << "};\nconst uint64_t syncTerminals[] = {";
+    vector<uint64_t> syncBits = syncTerminalBits();
+    for (int i = 0 ; i < terminalWords ; i++) output << (i ? ", " : "") << syncBits[i] << "ULL";
+    output << "};\nconst uint64_t validTerminals[][" << terminalWords << "] = {\n";
+    for (size_t state = 0 ; state < actionTable.size() ; state++) {
+        output << "    {";
+        for (int i = 0 ; i < terminalWords ; i++) output << (i ? ", " : "") << validTerminals[state * terminalWords + i] << "ULL";
+        output << "},\n";
+    }
+    output << "};\n\n";
+    for (size_t state = 0 ; state < actionTable.size() ; state++) output << "result state" << state << "();\n";
+    output << recursiveAscentRuntime;
+
+    for (size_t state = 0 ; state < actionTable.size() ; state++) {
+        output << "\nresult state" << state << "() {\n    result r;\n    while (true) {\n        switch (lookahead()) {\n";
+        //terminals with the same action and chain share a case
+        map<pair<int, int>, vector<int>> cases;
+        for (int t = 0 ; t < terminalCount ; t++) {
+            if (actionTable[state][t] == -1) continue;
+            int chain = chainTable[state].empty() ? -1 : chainTable[state][t];
+            cases[{actionTable[state][t], chain}].push_back(t);
+        }
+        for (auto& entry : cases) {
+            output << "       ";
+            for (int t : entry.second) output << " case " << t << ":";
+            output << "\n           ";
+            if (entry.first.second != -1) {
+                for (int i = entry.first.second ; unitChains[i] != -1 ; i++) output << " wrap(" << productions[unitChains[i]].left << ");";
             }
+            int action = entry.first.first;
+            if (!(action & 1)) output << " shift();\n            r = state" << (action >> 1) << "();\n";
+            else if (action >> 1 == 0) output << " return {0, ACCEPT};\n";
+            else output << " r = reduce(" << productions[action >> 1].left << ", " << productions[action >> 1].right.size() << ");\n";
+            if (action >> 1 != 0 || !(action & 1)) output << "            break;\n";
+        }
+        output << "        default:\n            r = error(" << state << ");\n        }\n";
+        output << "        while (r.pops == 0) {\n            switch (r.left) {\n";
+        for (int symbol = 0 ; symbol < nonTerminalCount ; symbol++) {
+            if (gotoTable[state][symbol] != -1) output << "            case " << symbol << ": r = state" << gotoTable[state][symbol] << "(); break;\n";
         }
+        output << "            default: return {0, FAIL};\n            }\n        }\n";
+        output << "        if (r.pops > 0) return {r.left, r.pops - 1};\n";
+        output << "        if (r.pops != RECOVER || popped(" << state << ")) return r;\n    }\n}\n";
     }
+}
 
-    cout << "DFA size: " << dfa.size() << '\n'; //ERR
+//Hash of the normalized grammar (the symbol lists, the productions in the order of the grammar and the sync set, all
+//separated the same way whatever the spacing of the input was), the options that change the tables and the table format
+uint64_t grammarHash() {
+    string normalized = "PPJP " + to_string(parserTableHeader().version) + (pagerMerge ? " pager" : "") + (lalrMerge ? " lalr" : "") +
+                        (skipUnits ? " skip-units" : "") + (keepUnitNodes ? " keep-unit-nodes" : "") + "\n%V";
+    for (int symbol = 1 ; symbol < nonTerminalCount ; symbol++) normalized += " " + symbolNames[symbol];
+    normalized += "\n%T";
+    for (int symbol = nonTerminalCount ; symbol < (int)symbolNames.size() ; symbol++) normalized += " " + symbolNames[symbol];
+    vector<string> syncNames;
+    for (const string& name : split(sync, ' ')) if (!name.empty()) syncNames.push_back(name);
+    sort(syncNames.begin(), syncNames.end());
+    normalized += "\n%Syn";
+    for (const string& name : syncNames) normalized += " " + name;
+    for (int p : grammarOrder) {
+        normalized += "\n" + symbolNames[productions[p].left] + " ->";
+        for (int symbol : productions[p].right) normalized += " " + symbolNames[symbol];
+    }
+    uint64_t h = 0xcbf29ce484222325ULL;     //FNV-1a
+    for (unsigned char c : normalized) h = (h ^ c) * 0x100000001b3ULL;
+    return h;
+}
 
-//LR(1) parser table
-//unordered_map<unordered_set<enfaState, enfaStateHash>, unordered_map<string, unordered_set<enfaState, enfaStateHash>>> dfa;
-//unordered_map<unordered_set<enfaState, enfaStateHash>, unordered_map<string, tuple<char, string, vector<string>>>, enfaStateSetHash> actionTable;
-//unordered_map<unordered_set<enfaState, enfaStateHash>, unordered_map<string, string>, enfaStateSetHash> newStateTable;
-    //action table
-    for (auto dfaStatePair : dfa) {
-        for (auto state : dfaStatePair.first) {
-            if (state.dot != state.right.size()) {  //move
-                
-            }
-            else {  //reduce
+//Path of the cached tables for the grammar
+string cachePath(uint64_t hash) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)hash);
+    return (fs::path(cacheDirectory) / name).string();
+}
 
-            }
+//Copies cached tables in place if the cache has a file of the right format for the grammar
+bool loadCachedTables(const string& cached, const string& path) {
+    ifstream input(cached, ios::binary);
+    parserTableHeader header;
+    if (!input.read((char*)&header, sizeof(header))) return false;
+    parserTableHeader expected;
+    if (!equal(header.magic, header.magic + 4, expected.magic) || header.version != expected.version) return false;
+    input.close();
+    error_code error;
+    fs::copy_file(cached, path, fs::copy_options::overwrite_existing, error);
+    return !error;
+}
+
+//Stores the tables in the cache, through a temporary file so a concurrent run never reads half of them
+void storeCachedTables(const string& path, const string& cached) {
+    error_code error;
+    fs::create_directories(cacheDirectory, error);
+    string temporary = cached + ".tmp" + to_string(random_device()());
+    fs::copy_file(path, temporary, fs::copy_options::overwrite_existing, error);
+    if (!error) fs::rename(temporary, cached, error);
+    if (error) fs::remove(temporary, error);
+}
+
+void endPhase(const string& name) {
+    auto now = chrono::steady_clock::now();
+    phaseTimes.push_back({name, chrono::duration<double, milli>(now - phaseStart).count()});
+    phaseStart = now;
+}
+
+//Writes the report as one JSON object: the grammar, where the tables came from, the phase times and the sizes
+void writeReport(const string& source, size_t tableBytes) {
+    ofstream output(reportPath);
+    output << "{\"terminals\": " << symbolNames.size() - nonTerminalCount << ", \"nonTerminals\": " << nonTerminalCount
+           << ", \"productions\": " << productions.size() << ", \"tables\": \"" << source << "\", \"phases\": {";
+    for (size_t i = 0 ; i < phaseTimes.size() ; i++) output << (i ? ", " : "") << '"' << phaseTimes[i].first << "\": " << phaseTimes[i].second;
+    output << "}, \"states\": " << states.size() << ", \"tableStates\": " << actionTable.size()
+           << ", \"shiftReduceConflicts\": " << shiftReduceConflicts << ", \"reduceReduceConflicts\": " << reduceReduceConflicts
+           << ", \"tableBytes\": " << tableBytes << ", \"denseBytes\": " << actionTable.size() * symbolNames.size() * sizeof(int32_t) << "}\n";
+}
+
+//Writes the normalized grammar for the analyzer to build its automaton from, in the format of the input
+void writeLazyGrammar(const string& path) {
+    ofstream output(path);
+    output << "%V";
+    for (int symbol = 1 ; symbol < nonTerminalCount ; symbol++) output << ' ' << symbolNames[symbol];
+    output << "\n%T";
+    for (int symbol = nonTerminalCount ; symbol < (int)symbolNames.size() ; symbol++) output << ' ' << symbolNames[symbol];
+    output << "\n%Syn " << sync << '\n';
+    int left = -1;
+    for (int p : grammarOrder) {
+        if (productions[p].left != left) output << symbolNames[left = productions[p].left] << '\n';
+        output << ' ';
+        if (productions[p].right.empty()) output << '$';
+        for (size_t i = 0 ; i < productions[p].right.size() ; i++) output << (i ? " " : "") << symbolNames[productions[p].right[i]];
+        output << '\n';
+    }
+}
+
+int main(int argc, char *argv[]) {
+    for (int i = 1 ; i < argc ; i++) {
+        string arg = argv[i];
+        if (arg == "--pager") pagerMerge = true;
+        else if (arg == "--lalr") lalrMerge = true;
+        else if (arg == "--threads" && i+1 < argc) threadCount = stoi(argv[++i]);
+        else if (arg == "--cache" && i+1 < argc) cacheDirectory = argv[++i];
+        else if (arg == "--lazy") lazyParsing = true;
+        else if (arg == "--skip-units") skipUnits = true;
+        else if (arg == "--keep-unit-nodes") skipUnits = keepUnitNodes = true;
+        else if (arg == "--recursive-ascent" && i+1 < argc) recursiveAscentPath = argv[++i];
+        else if (arg == "--report" && i+1 < argc) reportPath = argv[++i];
+    }
+
+//Help variables
+    string input;
+    vector<string> parts;
+    int currentNonTerminal = -1;
+
+//Reading inputs
+    getline(cin, input);    //Non-terminal symbols
+    parts = split(input, ' ');
+    intern("q0");
+    for (size_t i = 1 ; i < parts.size() ; i++) intern(parts[i]);
+    nonTerminalCount = symbolNames.size();
+    grammar.resize(nonTerminalCount);
+    productions.push_back({0, {1}});
+    grammar[0].push_back(0);
+    getline(cin, input);    //Terminal symbols
+    parts = split(input, ' ');
+    for (size_t i = 1 ; i < parts.size() ; i++) if (!parts[i].empty()) intern(parts[i]);
+    endSymbol = intern("%");   // % is the simbol for the end of sequence
+    getline(cin, sync);    //Sync terminal symbols
+    sync = sync.substr(5);
+
+    while (getline(cin, input)) {   //Productions
+        if (input == "!") break;    //ERR
+        if (input[0] != ' ') {
+            //only the non-terminals of %V have productions, the ones of an undeclared left side are skipped
+            auto it = symbolIds.find(input);
+            currentNonTerminal = it != symbolIds.end() && isNonTerminal(it->second) ? it->second : -1;
+            if (currentNonTerminal == -1) cerr << "Skipping the productions of " << input << ", it isn't in %V\n";
         }
+        else if (currentNonTerminal != -1) {
+            parts = split(input.substr(1), ' ');
+            if (!parts.empty() && parts[0] == "$") parts.erase(parts.begin());
+            production p = {currentNonTerminal, {}};
+            for (const string& part : parts) p.right.push_back(intern(part));
+            grammarOrder.push_back(productions.size());
+            grammar[currentNonTerminal].push_back(productions.size());
+            productions.push_back(p);
+        }
+    }
+    int symbolCount = symbolNames.size();   //undeclared symbols on the right are taken as terminals
+    lookaheadWords = ((symbolCount - nonTerminalCount + 63) / 64 + 3) / 4 * 4;
+    endPhase("read");
+
+    string tablePath = "./analizator/tables.bin";
+    if (lazyParsing) {
+        writeLazyGrammar("./analizator/grammar.txt");
+        error_code error;
+        fs::remove(tablePath, error);   //tables of an earlier grammar don't belong to this one
+        endPhase("write");
+        if (!reportPath.empty()) writeReport("lazy", 0);
+        return 0;
     }
+    error_code lazyError;
+    fs::remove("./analizator/grammar.txt", lazyError);  //left by an earlier --lazy run
+    string cached;
+    if (!cacheDirectory.empty()) {
+        cached = cachePath(grammarHash());
+        if (recursiveAscentPath.empty() && loadCachedTables(cached, tablePath)) {   //the parser is written from the tables
+            endPhase("cache");
+            if (!reportPath.empty()) writeReport("cache", fs::file_size(tablePath));
+            return 0;
+        }
+    }
+
+    findEmptyNonTerminals(symbolCount);
+    endPhase("nullable");
+    findStarts();
+    endPhase("first");
+    findRestStarts();
+    endPhase("cores");
+
+//LR(1) collection: canonical, or with compatible states merged as they are found
+    unsigned threads = pagerMerge || lalrMerge ? 1 : threadCount ? threadCount : max(1u, thread::hardware_concurrency());
+    workQueues = vector<workQueue>(threads);
+    addState({{0, 0, internTerminal(endSymbol)}});
+    vector<thread> workers;
+    for (unsigned i = 1 ; i < threads ; i++) workers.emplace_back(constructionWorker, i);
+    constructionWorker(0);
+    for (thread& worker : workers) worker.join();
+    collectStates();
+    endPhase("automaton");
+
+//LR(1) parser table
+    fillTables();
+    if (skipUnits) {
+        skipUnitProductions();
+        endPhase("units");
+    }
+    packTables();
+    endPhase("tables");
+    size_t tableBytes = writeTables(tablePath);
+    if (!recursiveAscentPath.empty()) writeRecursiveAscent(recursiveAscentPath);
+    if (!cached.empty()) storeCachedTables(tablePath, cached);
+    endPhase("write");
+    if (!reportPath.empty()) writeReport("generated", tableBytes);
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,243 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+/*
+Grammar analysis shared by the generator and the lazy automaton of the analyzer, so the tables and the automaton built while
+parsing come from the same code: empty non-terminals, starts, the starts of every production suffix, closure and the
+resolution of conflicts.
+Symbols are numbered with the augmented start q0 and the non-terminals first, then the terminals. Lookahead sets are bitsets
+over the terminals (bit symbol - nonTerminalCount) of lookaheadWords 64 bit words, interned by the program that includes this:
+it defines lookaheadSet (the bits of an id, they must not move while a closure is built) and internLookaheads.
+*/
+
+//Productions are numbered (production 0 is q0 -> start) and LR(1) items are (production, dot, lookahead set id) triples
+struct production {
+    int left;
+    vector<int> right;
+};
+
+struct lrItem {
+    int production;
+    int dot;
+    int lookaheads;     //id of the interned lookahead set
+
+    bool operator==(const lrItem& other) const {
+        return production == other.production && dot == other.dot && lookaheads == other.lookaheads;
+    }
+};
+
+//Kernels are kept sorted by (production, dot) and every (production, dot) appears at most once, so equal states have equal kernels
+struct kernelHash {
+    size_t operator()(const vector<lrItem>& kernel) const {
+        size_t h = kernel.size();
+        for (const lrItem& item : kernel) {
+            h ^= (size_t)item.production + 0x9e3779b9 + (h << 6) + (h >> 2);
+            h ^= (size_t)item.dot + 0x9e3779b9 + (h << 6) + (h >> 2);
+            h ^= (size_t)item.lookaheads + 0x9e3779b9 + (h << 6) + (h >> 2);
+        }
+        return h;
+    }
+};
+
+int nonTerminalCount;   //ids below are non-terminals
+int lookaheadWords;     //rounded up to a multiple of 4 so the word loops vectorize without a remainder
+vector<production> productions;
+vector<vector<int>> grammar;    //production numbers of every non-terminal
+vector<bool> emptyNonTerminal;  //by symbol
+vector<uint64_t> starts;        //terminals a non-terminal can start with, lookaheadWords words per row
+vector<int> coreStart;          //production -> id of its (production, 0) core, cores of a production are consecutive
+vector<int> coreProduction;     //core -> production
+vector<int> restStarts;         //core -> lookahead set id of the terminals the symbols after its dot can start with
+vector<bool> restEmpty;         //core -> can the symbols after its dot generate epsilon
+
+const uint64_t* lookaheadSet(int id);
+int internLookaheads(const uint64_t* bits);
+
+bool isNonTerminal(int symbol) {
+    return symbol < nonTerminalCount;
+}
+
+void setTerminal(uint64_t* bits, int symbol) {
+    bits[(symbol - nonTerminalCount) / 64] |= 1ULL << ((symbol - nonTerminalCount) % 64);
+}
+
+//Empty non-terminals: every production counts the symbols on its right that aren't known to be empty, a non-terminal is
+//empty once a count drops to 0
+void findEmptyNonTerminals(int symbolCount) {
+    emptyNonTerminal.assign(symbolCount, false);
+    vector<int> nonEmptyLeft(productions.size());
+    vector<vector<int>> occurrences(nonTerminalCount);  //productions with the non-terminal on the right, once per occurrence
+    vector<int> emptyWorklist;
+    for (size_t p = 0 ; p < productions.size() ; p++) {
+        nonEmptyLeft[p] = productions[p].right.size();
+        for (int symbol : productions[p].right) if (isNonTerminal(symbol)) occurrences[symbol].push_back(p);
+        if (nonEmptyLeft[p] == 0 && !emptyNonTerminal[productions[p].left]) {
+            emptyNonTerminal[productions[p].left] = true;
+            emptyWorklist.push_back(productions[p].left);
+        }
+    }
+    while (!emptyWorklist.empty()) {
+        int symbol = emptyWorklist.back();
+        emptyWorklist.pop_back();
+        for (int p : occurrences[symbol]) {
+            if (--nonEmptyLeft[p] == 0 && !emptyNonTerminal[productions[p].left]) {
+                emptyNonTerminal[productions[p].left] = true;
+                emptyWorklist.push_back(productions[p].left);
+            }
+        }
+    }
+}
+
+//Terminals every non-terminal can start with. The non-terminals a non-terminal starts with are a bit matrix of
+//nonTerminalWords words per row, closed with Warshall
+void findStarts() {
+    int nonTerminalWords = (nonTerminalCount + 63) / 64;
+    vector<uint64_t> startsWith((size_t)nonTerminalCount * nonTerminalWords, 0);    //itself included
+    starts.assign((size_t)nonTerminalCount * lookaheadWords, 0);
+    for (const production& p : productions) {
+        for (int symbol : p.right) { //everything until and including first non empty is a direct start for the left side
+            if (isNonTerminal(symbol)) startsWith[(size_t)p.left * nonTerminalWords + symbol / 64] |= 1ULL << (symbol % 64);
+            else setTerminal(starts.data() + (size_t)p.left * lookaheadWords, symbol);
+            if (!emptyNonTerminal[symbol]) break;
+        }
+    }
+
+    //Warshall's transitive closure over 64 bit words: after step k every row holds what it reaches through non-terminals up to k
+    for (int symbol = 0 ; symbol < nonTerminalCount ; symbol++) startsWith[(size_t)symbol * nonTerminalWords + symbol / 64] |= 1ULL << (symbol % 64);
+    for (int middle = 0 ; middle < nonTerminalCount ; middle++) {
+        const uint64_t* through = startsWith.data() + (size_t)middle * nonTerminalWords;
+        for (int left = 0 ; left < nonTerminalCount ; left++) {
+            uint64_t* row = startsWith.data() + (size_t)left * nonTerminalWords;
+            if (left == middle || !(row[middle / 64] >> (middle % 64) & 1)) continue;
+            for (int i = 0 ; i < nonTerminalWords ; i++) row[i] |= through[i];
+        }
+    }
+    //the terminals of a non-terminal are the direct terminals of everything it starts with
+    vector<uint64_t> directStarts = starts;
+    for (int left = 0 ; left < nonTerminalCount ; left++) {
+        const uint64_t* row = startsWith.data() + (size_t)left * nonTerminalWords;
+        uint64_t* terminals = starts.data() + (size_t)left * lookaheadWords;
+        for (int i = 0 ; i < nonTerminalWords ; i++) {
+            for (uint64_t word = row[i] ; word ; word &= word - 1) {
+                int middle = i * 64 + __builtin_ctzll(word);
+                if (middle == left) continue;
+                const uint64_t* direct = directStarts.data() + (size_t)middle * lookaheadWords;
+                for (int j = 0 ; j < lookaheadWords ; j++) terminals[j] |= direct[j];
+            }
+        }
+    }
+}
+
+//Cores and the starts of the rest of every production
+void findRestStarts() {
+    for (size_t p = 0 ; p < productions.size() ; p++) {
+        coreStart.push_back(coreProduction.size());
+        for (size_t dot = 0 ; dot <= productions[p].right.size() ; dot++) coreProduction.push_back(p);
+    }
+    restStarts.assign(coreProduction.size(), -1);
+    restEmpty.assign(coreProduction.size(), true);
+    for (size_t p = 0 ; p < productions.size() ; p++) {
+        const vector<int>& right = productions[p].right;
+        vector<uint64_t> terminals(lookaheadWords, 0);
+        bool empty = true;
+        for (int dot = right.size() ; dot >= 0 ; dot--) {   //from the end, so every core extends the one after it
+            if (dot < (int)right.size()) {
+                if (!emptyNonTerminal[right[dot]]) fill(terminals.begin(), terminals.end(), 0);
+                if (isNonTerminal(right[dot])) {
+                    const uint64_t* symbolStarts = starts.data() + (size_t)right[dot] * lookaheadWords;
+                    for (int i = 0 ; i < lookaheadWords ; i++) terminals[i] |= symbolStarts[i];
+                }
+                else setTerminal(terminals.data(), right[dot]);
+                empty = empty && emptyNonTerminal[right[dot]];
+            }
+            restStarts[coreStart[p] + dot] = internLookaheads(terminals.data());
+            restEmpty[coreStart[p] + dot] = empty;
+        }
+    }
+}
+
+//Scratch space of closure() for every thread, indexed by non-terminal
+thread_local vector<uint64_t> closureBits;   //lookaheadWords words per non-terminal
+thread_local vector<bool> closureTouched;
+thread_local vector<bool> closureQueued;
+
+//ORs the terminals the symbols after the core's dot start with (and the item's own lookaheads if they can generate epsilon)
+//into the lookaheads of the non-terminal after the dot, queueing it if they grew
+void closureAdd(int core, const uint64_t* itemLookaheads, vector<int>& touched, vector<int>& worklist) {
+    const production& p = productions[coreProduction[core]];
+    size_t dot = core - coreStart[coreProduction[core]];
+    if (dot == p.right.size() || !isNonTerminal(p.right[dot])) return;
+    int symbol = p.right[dot];
+    uint64_t* bits = closureBits.data() + (size_t)symbol * lookaheadWords;
+    const uint64_t* rest = lookaheadSet(restStarts[core + 1]);
+    uint64_t added = 0;
+    if (restEmpty[core + 1]) {
+        for (int i = 0 ; i < lookaheadWords ; i++) {
+            uint64_t word = rest[i] | itemLookaheads[i];
+            added |= word & ~bits[i];
+            bits[i] |= word;
+        }
+    } else {
+        for (int i = 0 ; i < lookaheadWords ; i++) {
+            added |= rest[i] & ~bits[i];
+            bits[i] |= rest[i];
+        }
+    }
+    if (!closureTouched[symbol]) {
+        closureTouched[symbol] = true;
+        touched.push_back(symbol);
+        added = 1;
+    }
+    if (added && !closureQueued[symbol]) {
+        closureQueued[symbol] = true;
+        worklist.push_back(symbol);
+    }
+}
+
+//Closure of a kernel with an iterative worklist. All the (production, 0) items of a non-terminal share their lookaheads,
+//so they are gathered as one bitset per non-terminal and only interned at the end
+//Returns the closure sorted by (production, dot)
+vector<lrItem> closure(const vector<lrItem>& kernel) {
+    if (closureTouched.empty()) {
+        closureBits.assign((size_t)nonTerminalCount * lookaheadWords, 0);
+        closureTouched.assign(nonTerminalCount, false);
+        closureQueued.assign(nonTerminalCount, false);
+    }
+    vector<int> touched;
+    vector<int> worklist;
+    for (const lrItem& item : kernel) closureAdd(coreStart[item.production] + item.dot, lookaheadSet(item.lookaheads), touched, worklist);
+    while (!worklist.empty()) {
+        int symbol = worklist.back();
+        worklist.pop_back();
+        closureQueued[symbol] = false;
+        for (int transition : grammar[symbol]) closureAdd(coreStart[transition], closureBits.data() + (size_t)symbol * lookaheadWords, touched, worklist);
+    }
+    vector<lrItem> result = kernel;
+    for (int symbol : touched) {
+        uint64_t* bits = closureBits.data() + (size_t)symbol * lookaheadWords;
+        int lookaheads = internLookaheads(bits);
+        for (int transition : grammar[symbol]) result.push_back({transition, 0, lookaheads});
+        fill(bits, bits + lookaheadWords, 0);
+        closureTouched[symbol] = false;
+    }
+    sort(result.begin(), result.end(), [](const lrItem& a, const lrItem& b) { return a.production != b.production ? a.production < b.production : a.dot < b.dot; });
+    return result;
+}
+
+//Conflicts: of two reductions the production given first in the grammar wins, and a shift wins over a reduction
+//Actions are (state << 1) to shift, (production << 1 | 1) to reduce and -1 for an error; both return if there was a conflict
+bool addReduce(int& action, int production) {
+    bool conflict = action != -1;
+    if (action == -1 || production < action >> 1) action = production << 1 | 1;
+    return conflict;
+}
+
+bool addShift(int& action, int state) {
+    bool conflict = action != -1;
+    action = state << 1;
+    return conflict;
+}
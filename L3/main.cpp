@@ -2,9 +2,23 @@
 #include <memory>
 #include <vector>
 #include <map>
+#include <unordered_map>
 
 using namespace std;
 
+// Identifiers are interned when the tree is loaded so scopes compare them as integers
+vector<string> symbolNames;
+unordered_map<string, int> symbolIds;
+
+int intern(const string& name) {
+    auto found = symbolIds.find(name);
+    if (found == symbolIds.end()) {
+        found = symbolIds.emplace(name, symbolNames.size()).first;
+        symbolNames.push_back(name);
+    }
+    return found->second;
+}
+
 enum class Type {
     NONE,
     CHAR,
@@ -37,7 +51,7 @@ struct Object {
     bool isFunction = false;
     bool isDefined = false;
     Type returnType = Type::NONE;
-    string postfixName = "";
+    int postfixName = -1;       // interned name of the function, -1 if none
     vector<Object> parameters;
 };
 
@@ -48,7 +62,7 @@ ostream& operator<<(ostream& os, const Object& obj) {
         << "IsFunction: " << obj.isFunction << ", "
         << "IsDefined: " << obj.isDefined << ", "
         << "ReturnType: " << typeToString(obj.returnType) << ", "
-        << "PostfixName: " << obj.postfixName << ", "
+        << "PostfixName: " << (obj.postfixName != -1 ? symbolNames[obj.postfixName] : "") << ", "
         << "Parameters: [";
     for (const auto& param : obj.parameters) {
         os << param << ", ";
@@ -58,7 +72,7 @@ ostream& operator<<(ostream& os, const Object& obj) {
 }
 
 struct Block : enable_shared_from_this<Block> {
-    map<string, Object> table;
+    map<int, Object> table;     // keyed by interned identifier
     Type function = Type::NONE;
     weak_ptr<Block> parent;
     vector<shared_ptr<Block>> children;
@@ -76,13 +90,14 @@ struct Branch : Node {
     bool lValue = false;
     int amount = 0;
     vector<Object> arguments;
-    vector<string> argumentNames;
+    vector<int> argumentNames;
     vector<unique_ptr<Node>> children;
 };
 
 struct Leaf : Node {
     string line = "";
     string data = "";
+    int id = -1;    // interned data of IDN leaves
 };
 
 bool canImplicit(const Object& from, const Object& to) {
@@ -195,6 +210,7 @@ void loadGenTree(Branch &branch, size_t depth) {
                 newLeaf->symbol = input.substr(0, firstSpace);
                 newLeaf->line = input.substr(firstSpace + 1, secondSpace - firstSpace - 1);
                 newLeaf->data = input.substr(secondSpace + 1);
+                if (newLeaf->symbol == "IDN") newLeaf->id = intern(newLeaf->data);
                 input.clear();
                 branch.children.push_back(move(newLeaf));
             }
@@ -219,7 +235,7 @@ void printError(Node &node) {
 }
 
 shared_ptr<Block> scopeTree = make_shared<Block>();
-vector<string> paramNamesBuffer;
+vector<int> paramNamesBuffer;
 vector<Object> paramsBuffer;
 Type functionTypeBuffer;
 bool minusBuffer = false;
@@ -232,9 +248,9 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                 if (child0->symbol == "IDN") {
                     Block* scopeCheck = currentScope;
                     bool exists = false;
-                    map<std::string, Object>::iterator it;
+                    map<int, Object>::iterator it;
                     do {
-                        it = scopeCheck->table.find(child0->data);
+                        it = scopeCheck->table.find(child0->id);
                         if (it != scopeCheck->table.end()) {
                             exists = true;
                             break;
@@ -242,17 +258,17 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                     } while ((scopeCheck = scopeCheck->parent.lock().get()));
 
                     if (exists) {
-                        if (!it->second.isFunction) branch->type = scopeCheck->table[child0->data];
+                        if (!it->second.isFunction) branch->type = scopeCheck->table[child0->id];
                         else {
                             Object obj;
                             obj.isFunction = true;
                             obj.type = Type::NONE;
-                            obj.postfixName = child0->data;
-                            obj.returnType = scopeCheck->table[child0->data].type;
-                            obj.parameters = scopeCheck->table[child0->data].parameters;
+                            obj.postfixName = child0->id;
+                            obj.returnType = scopeCheck->table[child0->id].type;
+                            obj.parameters = scopeCheck->table[child0->id].parameters;
                             branch->type = obj;
                         }
-                        branch->lValue = isLValue(scopeCheck->table[child0->data]);
+                        branch->lValue = isLValue(scopeCheck->table[child0->id]);
                     } else printError(*branch);
                 } else if (child0->symbol == "BROJ") {
                     if (isValidInt(child0->data, minusBuffer)) {
@@ -317,7 +333,7 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                 if (!child0->type.isFunction) printError(*branch);
                 if (child0->type.parameters.size() != 0) printError(*branch);
 
-                if (child0->type.postfixName != "") {
+                if (child0->type.postfixName != -1) {
                     auto scopeCheck = currentScope;
                     do {
                         if (scopeCheck->table.find(child0->type.postfixName) != scopeCheck->table.end()) {
@@ -758,7 +774,7 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
             resolveTree(*child0, currentScope, inLoop);
             if (child0->type.type == Type::INT || child0->type.type == Type::CHAR)
                 if (!child0->type.array && child0->type.con) printError(*branch);
-            auto it = scopeTree->table.find(child1->data);
+            auto it = scopeTree->table.find(child1->id);
             if (it != scopeTree->table.end()) {
                 Object &func = it->second;
                 if (func.isFunction && func.isDefined) printError(*branch);
@@ -771,14 +787,14 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                 func.type = child0->type.type;
                 func.isDefined = true;
                 functionTypeBuffer = child0->type.type;
-                scopeTree->table[child1->data] = func;
+                scopeTree->table[child1->id] = func;
             }
             resolveTree(*child5, currentScope, inLoop);
         } else {
             Branch* child3 = dynamic_cast<Branch*>(branch->children[3].get());
             resolveTree(*child0, currentScope, inLoop);
             if (child0->type.con) printError(*branch);
-            auto it = scopeTree->table.find(child1->data);
+            auto it = scopeTree->table.find(child1->id);
             if (it != scopeTree->table.end()) {
                 Object &func = it->second;
                 if (func.isFunction && func.isDefined) printError(*branch);
@@ -796,7 +812,7 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                 func.type = child0->type.type;
                 func.isDefined = true;
                 func.parameters = child3->arguments;
-                scopeTree->table[child1->data] = func;
+                scopeTree->table[child1->id] = func;
             }
             functionTypeBuffer = child0->type.type;
             paramsBuffer = child3->arguments;
@@ -818,7 +834,7 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                 Branch* child2 = dynamic_cast<Branch*>(branch->children[2].get());
                 resolveTree(*child0, currentScope, inLoop);
                 resolveTree(*child2, currentScope, inLoop);
-                for (string name : branch->argumentNames) {
+                for (int name : branch->argumentNames) {
                     if (name == child2->argumentNames[0]) printError(*branch);
                 }
                 branch->arguments = child0->arguments;
@@ -837,7 +853,7 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                 resolveTree(*child0, currentScope, inLoop);
                 if (child0->type.type == Type::VOID) printError(*branch);
                 branch->type = child0->type;
-                branch->argumentNames.push_back(child1->data);
+                branch->argumentNames.push_back(child1->id);
                 break;
             }
             case 4: {
@@ -848,7 +864,7 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                 Object obj = child0->type;
                 obj.array = true;
                 branch->type = obj;
-                branch->argumentNames.push_back(child1->data);
+                branch->argumentNames.push_back(child1->id);
                 break;
             }
         }
@@ -932,8 +948,8 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
             case 1: {
                 Leaf* child0 = dynamic_cast<Leaf*>(branch->children[0].get());
                 if (branch->nType.type == Type::VOID) printError(*branch);
-                if (currentScope->table.find(child0->data) != currentScope->table.end()) printError(*branch);
-                currentScope->table[child0->data] = branch->nType;
+                if (currentScope->table.find(child0->id) != currentScope->table.end()) printError(*branch);
+                currentScope->table[child0->id] = branch->nType;
                 branch->type = branch->nType;
                 break;
             }
@@ -942,15 +958,15 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                 Leaf* child2 = dynamic_cast<Leaf*>(branch->children[2].get());
                 if (branch->children[2].get()->symbol == "BROJ") {
                     if (branch->nType.type == Type::VOID) printError(*branch);
-                    if (currentScope->table.find(child0->data) != currentScope->table.end()) printError(*branch);
+                    if (currentScope->table.find(child0->id) != currentScope->table.end()) printError(*branch);
                     if (!isValidArraySize(child2->data)) printError(*branch);
                     Object obj = branch->nType;
                     obj.array = true;
-                    currentScope->table[child0->data] = obj;
+                    currentScope->table[child0->id] = obj;
                     branch->type = obj;
                     branch->amount = stoi(dynamic_cast<Leaf*>(branch->children[2].get())->data);
                 } else if (branch->children[2].get()->symbol == "KR_VOID") {
-                    auto it = currentScope->table.find(child0->data);
+                    auto it = currentScope->table.find(child0->id);
                     if (it != currentScope->table.end()) {
                         Object func = it->second;
                         if (!func.isFunction || func.parameters.size() != 0 || func.type != branch->nType.type) printError(*branch);
@@ -958,7 +974,7 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                         Object func;
                         func.isFunction = true;
                         func.type = branch->nType.type;
-                        currentScope->table[child0->data] = func;
+                        currentScope->table[child0->id] = func;
                     }
                     Object func;
                     func.isFunction = true;
@@ -967,7 +983,7 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                 } else {
                     Branch* child2 = dynamic_cast<Branch*>(branch->children[2].get());
                     resolveTree(*child2, currentScope, inLoop);
-                    auto it = currentScope->table.find(child0->data);
+                    auto it = currentScope->table.find(child0->id);
                     if (it != currentScope->table.end()) {
                         Object func = it->second;
                         if (!func.isFunction || func.parameters.size() != child2->arguments.size() || func.type != branch->nType.type) printError(*branch);
@@ -979,7 +995,7 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                         func.type = branch->nType.type;
                         func.parameters = child2->arguments;
                         func.isFunction = true;
-                        currentScope->table[child0->data] = func;
+                        currentScope->table[child0->id] = func;
                     }
                     Object func;
                     func.type = branch->nType.type;
@@ -1047,7 +1063,7 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
 }
 
 void checkMain(Block& block) {
-    auto it = block.table.find("main");
+    auto it = block.table.find(intern("main"));
     if (it == block.table.end()) {
         cout << "main\n";
         exit(0);
@@ -2,10 +2,24 @@
 #include <memory>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <fstream>
 
 using namespace std;
 
+// Identifiers are interned when the tree is loaded so scopes compare them as integers
+vector<string> symbolNames;
+unordered_map<string, int> symbolIds;
+
+int intern(const string& name) {
+    auto found = symbolIds.find(name);
+    if (found == symbolIds.end()) {
+        found = symbolIds.emplace(name, symbolNames.size()).first;
+        symbolNames.push_back(name);
+    }
+    return found->second;
+}
+
 enum class Type {
     NONE,
     CHAR,
@@ -38,7 +52,7 @@ struct Object {
     bool isFunction = false;
     bool isDefined = false;
     Type returnType = Type::NONE;
-    string postfixName = "";
+    int postfixName = -1;       // interned name of the function, -1 if none
     vector<Object> parameters;
 };
 
@@ -49,7 +63,7 @@ ostream& operator<<(ostream& os, const Object& obj) {
         << "IsFunction: " << obj.isFunction << ", "
         << "IsDefined: " << obj.isDefined << ", "
         << "ReturnType: " << typeToString(obj.returnType) << ", "
-        << "PostfixName: " << obj.postfixName << ", "
+        << "PostfixName: " << (obj.postfixName != -1 ? symbolNames[obj.postfixName] : "") << ", "
         << "Parameters: [";
     for (const auto& param : obj.parameters) {
         os << param << ", ";
@@ -59,10 +73,10 @@ ostream& operator<<(ostream& os, const Object& obj) {
 }
 
 struct Block : enable_shared_from_this<Block> {
-    map<string, Object> table;
+    map<int, Object> table;     // keyed by interned identifier
     Type function = Type::NONE;
-    vector<string> paramNames;
-    string functionName = "";
+    vector<int> paramNames;
+    int functionName = -1;
     weak_ptr<Block> parent;
     vector<shared_ptr<Block>> children;
     bool visited = false;
@@ -79,13 +93,14 @@ struct Branch : Node {
     bool lValue = false;
     int amount = 0;
     vector<Object> arguments;
-    vector<string> argumentNames;
+    vector<int> argumentNames;
     vector<unique_ptr<Node>> children;
 };
 
 struct Leaf : Node {
     string line = "";
     string data = "";
+    int id = -1;    // interned data of IDN leaves
 };
 
 bool canImplicit(const Object& from, const Object& to) {
@@ -178,10 +193,10 @@ bool isValidArraySize(string str) {
 
 void printScopeTree(const shared_ptr<Block>& block, int depth = 0) {
     for (int i = 0; i < depth; ++i) cout << "  ";
-    cout << "Function: " << block->functionName << "\n";
+    cout << "Function: " << (block->functionName != -1 ? symbolNames[block->functionName] : "") << "\n";
     for (const auto& pair : block->table) {
         for (int i = 0; i < depth + 1; ++i) cout << "  ";
-        cout << "Variable: " << pair.first << "\n";
+        cout << "Variable: " << symbolNames[pair.first] << "\n";
     }
     for (const auto& child : block->children) {
         printScopeTree(child, depth + 1);
@@ -210,6 +225,7 @@ void loadGenTree(Branch &branch, size_t depth) {
                 newLeaf->symbol = input.substr(0, firstSpace);
                 newLeaf->line = input.substr(firstSpace + 1, secondSpace - firstSpace - 1);
                 newLeaf->data = input.substr(secondSpace + 1);
+                if (newLeaf->symbol == "IDN") newLeaf->id = intern(newLeaf->data);
                 input.clear();
                 branch.children.push_back(move(newLeaf));
             }
@@ -234,10 +250,10 @@ void printError(Node &node) {
 }
 
 shared_ptr<Block> scopeTree = make_shared<Block>();
-vector<string> paramNamesBuffer;
+vector<int> paramNamesBuffer;
 vector<Object> paramsBuffer;
 Type functionTypeBuffer;
-string functionNameBuffer;
+int functionNameBuffer = -1;
 bool minusBuffer = false;
 void resolveTree(Node &node, Block* currentScope, bool inLoop) {
     Branch* branch = dynamic_cast<Branch*>(&node);
@@ -248,9 +264,9 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                 if (child0->symbol == "IDN") {
                     Block* scopeCheck = currentScope;
                     bool exists = false;
-                    map<std::string, Object>::iterator it;
+                    map<int, Object>::iterator it;
                     do {
-                        it = scopeCheck->table.find(child0->data);
+                        it = scopeCheck->table.find(child0->id);
                         if (it != scopeCheck->table.end()) {
                             exists = true;
                             break;
@@ -258,17 +274,17 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                     } while ((scopeCheck = scopeCheck->parent.lock().get()));
 
                     if (exists) {
-                        if (!it->second.isFunction) branch->type = scopeCheck->table[child0->data];
+                        if (!it->second.isFunction) branch->type = scopeCheck->table[child0->id];
                         else {
                             Object obj;
                             obj.isFunction = true;
                             obj.type = Type::NONE;
-                            obj.postfixName = child0->data;
-                            obj.returnType = scopeCheck->table[child0->data].type;
-                            obj.parameters = scopeCheck->table[child0->data].parameters;
+                            obj.postfixName = child0->id;
+                            obj.returnType = scopeCheck->table[child0->id].type;
+                            obj.parameters = scopeCheck->table[child0->id].parameters;
                             branch->type = obj;
                         }
-                        branch->lValue = isLValue(scopeCheck->table[child0->data]);
+                        branch->lValue = isLValue(scopeCheck->table[child0->id]);
                     } else printError(*branch);
                 } else if (child0->symbol == "BROJ") {
                     if (isValidInt(child0->data, minusBuffer)) {
@@ -333,7 +349,7 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                 if (!child0->type.isFunction) printError(*branch);
                 if (child0->type.parameters.size() != 0) printError(*branch);
 
-                if (child0->type.postfixName != "") {
+                if (child0->type.postfixName != -1) {
                     auto scopeCheck = currentScope;
                     do {
                         if (scopeCheck->table.find(child0->type.postfixName) != scopeCheck->table.end()) {
@@ -577,7 +593,7 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                     currentScope->function = functionTypeBuffer;
                     functionTypeBuffer = Type::NONE;
                     currentScope->functionName = functionNameBuffer;
-                    functionNameBuffer = "";
+                    functionNameBuffer = -1;
                 }
                 if (!paramsBuffer.empty()) {
                     for (size_t i = 0; i < paramsBuffer.size(); i++) {
@@ -602,7 +618,7 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                     currentScope->function = functionTypeBuffer;
                     functionTypeBuffer = Type::NONE;
                     currentScope->functionName = functionNameBuffer;
-                    functionNameBuffer = "";
+                    functionNameBuffer = -1;
                 }
                 if (!paramsBuffer.empty()) {
                     for (size_t i = 0; i < paramsBuffer.size(); i++) {
@@ -779,29 +795,29 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
             resolveTree(*child0, currentScope, inLoop);
             if (child0->type.type == Type::INT || child0->type.type == Type::CHAR)
                 if (!child0->type.array && child0->type.con) printError(*branch);
-            auto it = scopeTree->table.find(child1->data);
+            auto it = scopeTree->table.find(child1->id);
             if (it != scopeTree->table.end()) {
                 Object &func = it->second;
                 if (func.isFunction && func.isDefined) printError(*branch);
                 if (!func.isFunction || func.type != child0->type.type || func.parameters.size() != 0) printError(*branch);
                 func.isDefined = true;
                 functionTypeBuffer = child0->type.type;
-                functionNameBuffer = child1->data;
+                functionNameBuffer = child1->id;
             } else {
                 Object func;
                 func.isFunction = true;
                 func.type = child0->type.type;
                 func.isDefined = true;
                 functionTypeBuffer = child0->type.type;
-                functionNameBuffer = child1->data;
-                scopeTree->table[child1->data] = func;
+                functionNameBuffer = child1->id;
+                scopeTree->table[child1->id] = func;
             }
             resolveTree(*child5, currentScope, inLoop);
         } else {
             Branch* child3 = dynamic_cast<Branch*>(branch->children[3].get());
             resolveTree(*child0, currentScope, inLoop);
             if (child0->type.con) printError(*branch);
-            auto it = scopeTree->table.find(child1->data);
+            auto it = scopeTree->table.find(child1->id);
             if (it != scopeTree->table.end()) {
                 Object &func = it->second;
                 if (func.isFunction && func.isDefined) printError(*branch);
@@ -819,10 +835,10 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                 func.type = child0->type.type;
                 func.isDefined = true;
                 func.parameters = child3->arguments;
-                scopeTree->table[child1->data] = func;
+                scopeTree->table[child1->id] = func;
             }
             functionTypeBuffer = child0->type.type;
-            functionNameBuffer = child1->data;
+            functionNameBuffer = child1->id;
             paramsBuffer = child3->arguments;
             paramNamesBuffer = child3->argumentNames;
             resolveTree(*child5, currentScope, inLoop);
@@ -842,7 +858,7 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                 Branch* child2 = dynamic_cast<Branch*>(branch->children[2].get());
                 resolveTree(*child0, currentScope, inLoop);
                 resolveTree(*child2, currentScope, inLoop);
-                for (string name : branch->argumentNames) {
+                for (int name : branch->argumentNames) {
                     if (name == child2->argumentNames[0]) printError(*branch);
                 }
                 branch->arguments = child0->arguments;
@@ -861,7 +877,7 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                 resolveTree(*child0, currentScope, inLoop);
                 if (child0->type.type == Type::VOID) printError(*branch);
                 branch->type = child0->type;
-                branch->argumentNames.push_back(child1->data);
+                branch->argumentNames.push_back(child1->id);
                 break;
             }
             case 4: {
@@ -872,7 +888,7 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                 Object obj = child0->type;
                 obj.array = true;
                 branch->type = obj;
-                branch->argumentNames.push_back(child1->data);
+                branch->argumentNames.push_back(child1->id);
                 break;
             }
         }
@@ -956,8 +972,8 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
             case 1: {
                 Leaf* child0 = dynamic_cast<Leaf*>(branch->children[0].get());
                 if (branch->nType.type == Type::VOID) printError(*branch);
-                if (currentScope->table.find(child0->data) != currentScope->table.end()) printError(*branch);
-                currentScope->table[child0->data] = branch->nType;
+                if (currentScope->table.find(child0->id) != currentScope->table.end()) printError(*branch);
+                currentScope->table[child0->id] = branch->nType;
                 branch->type = branch->nType;
                 break;
             }
@@ -966,15 +982,15 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                 if (branch->children[2].get()->symbol == "BROJ") {
                     Leaf* child2 = dynamic_cast<Leaf*>(branch->children[2].get());
                     if (branch->nType.type == Type::VOID) printError(*branch);
-                    if (currentScope->table.find(child0->data) != currentScope->table.end()) printError(*branch);
+                    if (currentScope->table.find(child0->id) != currentScope->table.end()) printError(*branch);
                     if (!isValidArraySize(child2->data)) printError(*branch);
                     Object obj = branch->nType;
                     obj.array = true;
-                    currentScope->table[child0->data] = obj;
+                    currentScope->table[child0->id] = obj;
                     branch->type = obj;
                     branch->amount = stoi(dynamic_cast<Leaf*>(branch->children[2].get())->data);
                 } else if (branch->children[2].get()->symbol == "KR_VOID") {
-                    auto it = currentScope->table.find(child0->data);
+                    auto it = currentScope->table.find(child0->id);
                     if (it != currentScope->table.end()) {
                         Object func = it->second;
                         if (!func.isFunction || func.parameters.size() != 0 || func.type != branch->nType.type) printError(*branch);
@@ -982,7 +998,7 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                         Object func;
                         func.isFunction = true;
                         func.type = branch->nType.type;
-                        currentScope->table[child0->data] = func;
+                        currentScope->table[child0->id] = func;
                     }
                     Object func;
                     func.isFunction = true;
@@ -991,7 +1007,7 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                 } else {
                     Branch* child2 = dynamic_cast<Branch*>(branch->children[2].get());
                     resolveTree(*child2, currentScope, inLoop);
-                    auto it = currentScope->table.find(child0->data);
+                    auto it = currentScope->table.find(child0->id);
                     if (it != currentScope->table.end()) {
                         Object func = it->second;
                         if (!func.isFunction || func.parameters.size() != child2->arguments.size() || func.type != branch->nType.type) printError(*branch);
@@ -1003,7 +1019,7 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
                         func.type = branch->nType.type;
                         func.parameters = child2->arguments;
                         func.isFunction = true;
-                        currentScope->table[child0->data] = func;
+                        currentScope->table[child0->id] = func;
                     }
                     Object func;
                     func.type = branch->nType.type;
@@ -1071,7 +1087,7 @@ void resolveTree(Node &node, Block* currentScope, bool inLoop) {
 }
 
 void checkMain(Block& block) {
-    auto it = block.table.find("main");
+    auto it = block.table.find(intern("main"));
     if (it == block.table.end()) {
         cout << "main\n";
         exit(2);
@@ -1111,7 +1127,12 @@ void checkFunctionDefinitions(Block& block, Block& global) {
     }
 }
 
-string idnNamebuffer = "";  // Saves the name of an identifier that is about to be initialized
+int idnNamebuffer = -1;  // Saves the interned name of an identifier that is about to be initialized
+// Name of the buffered identifier, empty if none was buffered (array declarators don't set it)
+const string& bufferedName() {
+    static const string none;
+    return idnNamebuffer == -1 ? none : symbolNames[idnNamebuffer];
+}
 string globalValueBuffer = "";  // Saves the value of a global variable that is about to be initialized //TO-DO make it support calculations
 int buffersOnStack = 0; // Number of computation variables on stack, this does not include scope variables (function arguments are included in scope variables)
 int numberOfArguments = 0;  // Number of function arguments
@@ -1127,7 +1148,7 @@ void generateCodeRecursive(Node &node, Block* currentScope) {
                     int offset = 0;
                     do {
                         for (auto &child : scopeTree->children) {   // Handle the case when the identifier is of a function
-                            if (child->functionName == child0->data) {
+                            if (child->functionName == child0->id) {
                                 cout << "\tCALL F_" << child0->data << "\n";
                                 if (numberOfArguments > 0) {
                                     cout << "\tADD R7, %D " << 4 * numberOfArguments << ", R7\n";
@@ -1140,7 +1161,7 @@ void generateCodeRecursive(Node &node, Block* currentScope) {
                             }
                         }
 
-                        auto it = scopeCheck->table.find(child0->data);
+                        auto it = scopeCheck->table.find(child0->id);
                         if (it != scopeCheck->table.end()) {
                             if (scopeCheck->parent.lock() == nullptr) { // Handle the case when the variable is found in global scope
                                 cout << "\tLOAD R1, (G_" << child0->data << ")\n";
@@ -1150,7 +1171,7 @@ void generateCodeRecursive(Node &node, Block* currentScope) {
                             else {  // Handle the case when the variable is found in non-global scope
                                 int i = 0;
                                 for (auto it = scopeCheck->table.begin(); it != scopeCheck->table.end(); it++, i++) {
-                                    if (it->first == child0->data) {
+                                    if (it->first == child0->id) {
                                         cout << "\tLOAD R1, (R7+0" << hex << 4 * (i + offset + buffersOnStack) << dec << ")\n";
                                         cout << "\tPUSH R1\n";
                                         buffersOnStack++;
@@ -1572,9 +1593,9 @@ void generateCodeRecursive(Node &node, Block* currentScope) {
     }
     else if (branch->symbol == "<slozena_naredba>") {
         bool needToClear = false;   // Flag that indicates if we need to clear the stack after the scope (functions are cleared in the caller)
-        if (!functionNameBuffer.empty()) {
+        if (functionNameBuffer != -1) {
             // It is guaranteed that we are in the root scope where the function is defined
-            cout << "\nF_" << functionNameBuffer << "\n";
+            cout << "\nF_" << symbolNames[functionNameBuffer] << "\n";
 
             for (auto &child : currentScope->children) {    // Find the scope of the function
                 if (child->functionName == functionNameBuffer) {
@@ -1583,7 +1604,7 @@ void generateCodeRecursive(Node &node, Block* currentScope) {
                 }
             }
 
-            functionNameBuffer.clear();
+            functionNameBuffer = -1;
     
             if (currentScope->table.size() > 0) {
                 cout << "\tSUB R7, %D " << 4 * currentScope->table.size() << ", R7\n";     // Make space for local variables
@@ -1605,7 +1626,7 @@ void generateCodeRecursive(Node &node, Block* currentScope) {
                 ------------
                 BOTTOM OF STACK
             */
-            vector<string> paramNames = currentScope->paramNames;
+            vector<int> paramNames = currentScope->paramNames;
             if (paramNames.size() > 0) {
                 for (int i = paramNames.size() - 1; i >= 0; i--) {
                     int j = 0;
@@ -1789,7 +1810,7 @@ void generateCodeRecursive(Node &node, Block* currentScope) {
     }
     else if (branch->symbol == "<definicija_funkcije>") {
         Leaf* child1 = dynamic_cast<Leaf*>(branch->children[1].get());
-        functionNameBuffer = child1->data;
+        functionNameBuffer = child1->id;
 
         Branch* child0 = dynamic_cast<Branch*>(branch->children[0].get());
         generateCodeRecursive(*child0, currentScope);
@@ -1865,8 +1886,8 @@ void generateCodeRecursive(Node &node, Block* currentScope) {
                 generateCodeRecursive(*child0, currentScope);
                 
                 if (currentScope->parent.lock() == nullptr) {
-                    cout << "\nG_" << idnNamebuffer << "\tDW %D 0\n";   // Declared uninitialized global variable
-                    idnNamebuffer.clear();
+                    cout << "\nG_" << bufferedName() << "\tDW %D 0\n";   // Declared uninitialized global variable
+                    idnNamebuffer = -1;
                 }
                 // else declared uninitialized local variable (do nothing cause undefined)
                 break;
@@ -1883,8 +1904,8 @@ void generateCodeRecursive(Node &node, Block* currentScope) {
                         num = -num;
                         minusBuffer = false;
                     }
-                    cout << "\nG_" << idnNamebuffer << "\tDW %D " << num << "\n";   // Initialized global variable
-                    idnNamebuffer.clear();
+                    cout << "\nG_" << bufferedName() << "\tDW %D " << num << "\n";   // Initialized global variable
+                    idnNamebuffer = -1;
                 }
                 else {  // Initialized local variable
                     int offset = 0;
@@ -1914,7 +1935,7 @@ void generateCodeRecursive(Node &node, Block* currentScope) {
         switch (branch->children.size()) {
             case 1: {
                 Leaf* child0 = dynamic_cast<Leaf*>(branch->children[0].get());
-                idnNamebuffer = child0->data;
+                idnNamebuffer = child0->id;
                 break;
             }
             case 4: {
@@ -1960,7 +1981,7 @@ void generateCode(Node &node, Block* currentScope) {
     cout << "\tHALT\n";
 
     minusBuffer = false;
-    functionNameBuffer.clear();
+    functionNameBuffer = -1;
 
     cout << uppercase;
 